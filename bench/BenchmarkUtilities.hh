@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <fbi/Kernels.hh>
+#include <fbi/fbi.hh>
+
+namespace benchmarks {
+using fbi::BigUnsigned;
+
+// Returns a random number of exactly `blocks' blocks.
+inline BigUnsigned randomBigUnsigned(std::mt19937_64& rng, BigUnsigned::Index blocks)
+{
+    std::vector<BigUnsigned::Blk> b(blocks);
+    for (auto& x : b)
+        x = rng();
+    b.back() |= BigUnsigned::Blk(1) << (BigUnsigned::N - 1);
+    return BigUnsigned{ b.data(), blocks };
+}
+
+// Returns a random odd number of exactly `blocks' blocks.
+inline BigUnsigned randomOdd(std::mt19937_64& rng, BigUnsigned::Index blocks)
+{
+    return randomBigUnsigned(rng, blocks) | 1;
+}
+
+// How KernelScope reaches each kind of kernel family.
+template <class Kernels>
+struct KernelFamilies;
+
+template <>
+struct KernelFamilies<fbi::detail::MultiplyKernels> {
+    static const fbi::detail::MultiplyKernels& active() { return fbi::detail::multiplyKernels(); }
+    static const std::vector<const fbi::detail::MultiplyKernels*>& available()
+    {
+        return fbi::detail::availableMultiplyKernels();
+    }
+    static void select(const fbi::detail::MultiplyKernels& k) { fbi::detail::selectMultiplyKernels(k); }
+};
+
+template <>
+struct KernelFamilies<fbi::detail::BitwiseKernels> {
+    static const fbi::detail::BitwiseKernels& active() { return fbi::detail::bitwiseKernels(); }
+    static const std::vector<const fbi::detail::BitwiseKernels*>& available()
+    {
+        return fbi::detail::availableBitwiseKernels();
+    }
+    static void select(const fbi::detail::BitwiseKernels& k) { fbi::detail::selectBitwiseKernels(k); }
+};
+
+/* Selects kernel family range(1) for the lifetime of the object, and restores
+ * the default afterwards.  Families the processor lacks skip the run. */
+template <class Kernels>
+class KernelScope {
+public:
+    explicit KernelScope(benchmark::State& state) : active(KernelFamilies<Kernels>::active())
+    {
+        const auto& available = KernelFamilies<Kernels>::available();
+        std::size_t i = std::size_t(state.range(1));
+        if (i >= available.size()) {
+            state.SkipWithError("kernel family not supported");
+            return;
+        }
+        KernelFamilies<Kernels>::select(*available[i]);
+        state.SetLabel(available[i]->name);
+    }
+    ~KernelScope() { KernelFamilies<Kernels>::select(active); }
+
+private:
+    const Kernels& active;
+};
+} // namespace benchmarks
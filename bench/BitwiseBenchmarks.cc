@@ -0,0 +1,93 @@
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <fbi/fbi.hh>
+
+#include "BenchmarkUtilities.hh"
+
+using namespace fbi;
+using namespace benchmarks;
+
+namespace {
+typedef KernelScope<detail::BitwiseKernels> BitwiseKernelScope;
+
+// Bitsets from a cache-resident 1024 blocks up to 8 MiB.
+void kernelArgs(benchmark::internal::Benchmark* b)
+{
+    for (int family = 0; family < 5; family++)
+        for (int blocks : { 1 << 10, 1 << 14, 1 << 20 })
+            b->Args({ blocks, family });
+}
+} // namespace
+
+static void BM_BitXor(benchmark::State& state)
+{
+    BitwiseKernelScope scope(state);
+    std::mt19937_64 rng(state.range(0));
+    BigUnsigned a = randomBigUnsigned(rng, BigUnsigned::Index(state.range(0)));
+    BigUnsigned b = randomBigUnsigned(rng, BigUnsigned::Index(state.range(0)));
+    BigUnsigned r = a;
+    for (auto _ : state) {
+        r ^= b;
+        benchmark::DoNotOptimize(r);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(BigUnsigned::Blk));
+}
+BENCHMARK(BM_BitXor)->Apply(kernelArgs);
+
+static void BM_BitAnd(benchmark::State& state)
+{
+    BitwiseKernelScope scope(state);
+    std::mt19937_64 rng(state.range(0));
+    BigUnsigned a = randomBigUnsigned(rng, BigUnsigned::Index(state.range(0)));
+    BigUnsigned b = randomBigUnsigned(rng, BigUnsigned::Index(state.range(0)));
+    BigUnsigned r;
+    for (auto _ : state) {
+        r.bitAnd(a, b);
+        benchmark::DoNotOptimize(r);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(BigUnsigned::Blk));
+}
+BENCHMARK(BM_BitAnd)->Apply(kernelArgs);
+
+// Equal numbers, so the search for the most significant difference runs to the bottom.
+static void BM_CompareEqual(benchmark::State& state)
+{
+    BitwiseKernelScope scope(state);
+    std::mt19937_64 rng(state.range(0));
+    BigUnsigned a = randomBigUnsigned(rng, BigUnsigned::Index(state.range(0)));
+    BigUnsigned b = a;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(a.compareTo(b));
+    state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(BigUnsigned::Blk));
+}
+BENCHMARK(BM_CompareEqual)->Apply(kernelArgs);
+
+// An in-place shift by a whole number of blocks plus a few bits, and back.
+static void BM_ShiftInPlace(benchmark::State& state)
+{
+    BitwiseKernelScope scope(state);
+    std::mt19937_64 rng(state.range(0));
+    BigUnsigned r = randomBigUnsigned(rng, BigUnsigned::Index(state.range(0)));
+    for (auto _ : state) {
+        r <<= 133;
+        r >>= 133;
+        benchmark::DoNotOptimize(r);
+    }
+    state.SetBytesProcessed(2 * state.iterations() * state.range(0) * sizeof(BigUnsigned::Blk));
+}
+BENCHMARK(BM_ShiftInPlace)->Apply(kernelArgs);
+
+static void BM_HammingDistance(benchmark::State& state)
+{
+    BitwiseKernelScope scope(state);
+    std::mt19937_64 rng(state.range(0));
+    BigUnsigned a = randomBigUnsigned(rng, BigUnsigned::Index(state.range(0)));
+    BigUnsigned b = randomBigUnsigned(rng, BigUnsigned::Index(state.range(0)));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(a.hammingDistance(b));
+    state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(BigUnsigned::Blk));
+}
+BENCHMARK(BM_HammingDistance)->Apply(kernelArgs);
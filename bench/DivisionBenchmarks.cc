@@ -0,0 +1,58 @@
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <fbi/fbi.hh>
+
+#include "BenchmarkUtilities.hh"
+
+using namespace fbi;
+using namespace benchmarks;
+
+namespace {
+// A 2n-block dividend that is an exact multiple of an n-block divisor.
+struct DivisionOperands {
+    BigUnsigned a, b;
+
+    explicit DivisionOperands(BigUnsigned::Index blocks)
+    {
+        std::mt19937_64 rng(blocks);
+        b = randomBigUnsigned(rng, blocks);
+        a = b * randomBigUnsigned(rng, blocks);
+    }
+};
+} // namespace
+
+static void BM_Quotient(benchmark::State& state)
+{
+    DivisionOperands op(BigUnsigned::Index(state.range(0)));
+    BigUnsigned q;
+    for (auto _ : state) {
+        q.quotient(op.a, op.b);
+        benchmark::DoNotOptimize(q);
+    }
+}
+BENCHMARK(BM_Quotient)->Arg(1)->Arg(4)->Arg(16)->Arg(64)->Arg(256);
+
+static void BM_Mod(benchmark::State& state)
+{
+    DivisionOperands op(BigUnsigned::Index(state.range(0)));
+    BigUnsigned r;
+    for (auto _ : state) {
+        r.mod(op.a, op.b);
+        benchmark::DoNotOptimize(r);
+    }
+}
+BENCHMARK(BM_Mod)->Arg(1)->Arg(4)->Arg(16)->Arg(64)->Arg(256);
+
+static void BM_DivideExact(benchmark::State& state)
+{
+    DivisionOperands op(BigUnsigned::Index(state.range(0)));
+    BigUnsigned q;
+    for (auto _ : state) {
+        q.divideExact(op.a, op.b);
+        benchmark::DoNotOptimize(q);
+    }
+}
+BENCHMARK(BM_DivideExact)->Arg(1)->Arg(4)->Arg(16)->Arg(64)->Arg(256);
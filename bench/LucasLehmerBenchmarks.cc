@@ -0,0 +1,45 @@
+#include <benchmark/benchmark.h>
+
+#include <fbi/fbi.hh>
+
+using namespace fbi;
+
+namespace {
+/* The Lucas-Lehmer test: 2^p - 1 is prime iff s_(p-2) == 0, where s_0 = 4
+ * and s_(i+1) = s_i^2 - 2 mod 2^p - 1.  The squaring step is passed in so
+ * the same loop measures each way of reducing. */
+template <class Square>
+bool lucasLehmer(unsigned int p, const BigUnsigned& m, Square square)
+{
+    BigUnsigned s = 4;
+    for (unsigned int i = 2; i < p; i++) {
+        s = square(s);
+        s = (s >= 2) ? s - 2 : s + m - 2;
+    }
+    return s.isZero();
+}
+} // namespace
+
+static void BM_LucasLehmerDivision(benchmark::State& state)
+{
+    unsigned int p = unsigned(state.range(0));
+    BigUnsigned m = (BigUnsigned(1) << int(p)) - 1;
+    for (auto _ : state) {
+        bool prime = lucasLehmer(p, m, [&](const BigUnsigned& s) { return s * s % m; });
+        if (!prime)
+            state.SkipWithError("Mersenne prime reported as composite");
+    }
+}
+BENCHMARK(BM_LucasLehmerDivision)->Arg(521)->Arg(1279)->Arg(2203)->Unit(benchmark::kMillisecond);
+
+static void BM_LucasLehmerSpecialModulus(benchmark::State& state)
+{
+    unsigned int p = unsigned(state.range(0));
+    SpecialModulus m((BigUnsigned(1) << int(p)) - 1);
+    for (auto _ : state) {
+        bool prime = lucasLehmer(p, m.getModulus(), [&](const BigUnsigned& s) { return m.multiply(s, s); });
+        if (!prime)
+            state.SkipWithError("Mersenne prime reported as composite");
+    }
+}
+BENCHMARK(BM_LucasLehmerSpecialModulus)->Arg(521)->Arg(1279)->Arg(2203)->Arg(4423)->Unit(benchmark::kMillisecond);
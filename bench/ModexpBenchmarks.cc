@@ -0,0 +1,43 @@
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <fbi/fbi.hh>
+
+#include "BenchmarkUtilities.hh"
+
+using namespace fbi;
+using namespace benchmarks;
+
+namespace {
+/* Operands for an exponentiation with an odd modulus, a base and an
+ * exponent of the given number of blocks. */
+struct ModexpOperands {
+    BigUnsigned base, exponent, modulus;
+
+    explicit ModexpOperands(BigUnsigned::Index blocks)
+    {
+        std::mt19937_64 rng(blocks);
+        modulus = randomBigUnsigned(rng, blocks) | 1;
+        base = randomBigUnsigned(rng, blocks) % modulus;
+        exponent = randomBigUnsigned(rng, blocks);
+    }
+};
+} // namespace
+
+static void BM_Modexp(benchmark::State& state)
+{
+    ModexpOperands op(BigUnsigned::Index(state.range(0)));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(modexp(op.base, op.exponent, op.modulus));
+}
+BENCHMARK(BM_Modexp)->Arg(4)->Arg(16)->Arg(32)->Arg(64)->Unit(benchmark::kMicrosecond);
+
+static void BM_ModexpConstantTime(benchmark::State& state)
+{
+    ModexpOperands op(BigUnsigned::Index(state.range(0)));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(modexpConstantTime(op.base, op.exponent, op.modulus));
+}
+BENCHMARK(BM_ModexpConstantTime)->Arg(4)->Arg(16)->Arg(32)->Arg(64)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,88 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <fbi/fbi.hh>
+
+#include "BenchmarkUtilities.hh"
+
+using namespace fbi;
+using namespace benchmarks;
+
+namespace {
+typedef KernelScope<detail::MultiplyKernels> MultiplyKernelScope;
+
+void kernelArgs(benchmark::internal::Benchmark* b)
+{
+    for (int family = 0; family < 4; family++)
+        for (int blocks : { 4, 8, 16, 32, 64 })
+            b->Args({ blocks, family });
+}
+} // namespace
+
+static void BM_Multiply(benchmark::State& state)
+{
+    MultiplyKernelScope scope(state);
+    std::mt19937_64 rng(state.range(0));
+    BigUnsigned a = randomBigUnsigned(rng, BigUnsigned::Index(state.range(0)));
+    BigUnsigned b = randomBigUnsigned(rng, BigUnsigned::Index(state.range(0)));
+    BigUnsigned r;
+    for (auto _ : state) {
+        r.multiply(a, b);
+        benchmark::DoNotOptimize(r);
+    }
+}
+BENCHMARK(BM_Multiply)->Apply(kernelArgs);
+
+static void BM_Square(benchmark::State& state)
+{
+    MultiplyKernelScope scope(state);
+    std::mt19937_64 rng(state.range(0));
+    BigUnsigned a = randomBigUnsigned(rng, BigUnsigned::Index(state.range(0)));
+    BigUnsigned r;
+    for (auto _ : state) {
+        r.multiply(a, a);
+        benchmark::DoNotOptimize(r);
+    }
+}
+BENCHMARK(BM_Square)->Apply(kernelArgs);
+
+static void BM_MontgomeryMultiply(benchmark::State& state)
+{
+    MultiplyKernelScope scope(state);
+    std::mt19937_64 rng(state.range(0));
+    BigUnsigned::Index k = BigUnsigned::Index(state.range(0));
+    MontgomeryContext context(randomBigUnsigned(rng, k) | 1);
+    std::vector<BigUnsigned::Blk> a(k), b(k), t(2 * k);
+    context.load(a.data(), randomBigUnsigned(rng, k));
+    context.load(b.data(), randomBigUnsigned(rng, k));
+    for (auto _ : state) {
+        context.multiplyBlocks(a.data(), a.data(), b.data(), t.data());
+        benchmark::DoNotOptimize(a.data());
+    }
+}
+BENCHMARK(BM_MontgomeryMultiply)->Apply(kernelArgs);
+
+static void BM_Pow(benchmark::State& state)
+{
+    for (auto _ : state)
+        benchmark::DoNotOptimize(pow(BigUnsigned(3), std::uint64_t(state.range(0))));
+}
+BENCHMARK(BM_Pow)->Arg(1000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+
+static void BM_Factorial(benchmark::State& state)
+{
+    for (auto _ : state)
+        benchmark::DoNotOptimize(factorial(BigUnsigned::Index(state.range(0))));
+}
+BENCHMARK(BM_Factorial)->Arg(1000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+
+static void BM_Binomial(benchmark::State& state)
+{
+    BigUnsigned::Index n = BigUnsigned::Index(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(binomial(n, n / 2));
+}
+BENCHMARK(BM_Binomial)->Arg(1000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,53 @@
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <fbi/fbi.hh>
+
+#include "BenchmarkUtilities.hh"
+
+using namespace fbi;
+using namespace benchmarks;
+
+// The Mersenne primes 2^p - 1, which pass every round.
+static void BM_IsProbablePrime(benchmark::State& state)
+{
+    BigUnsigned n = (BigUnsigned(1) << int(state.range(0))) - 1;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(isProbablePrime(n, 10));
+}
+BENCHMARK(BM_IsProbablePrime)->Arg(521)->Arg(1279)->Arg(2203)->Unit(benchmark::kMicrosecond);
+
+static void BM_IsBPSWPrime(benchmark::State& state)
+{
+    BigUnsigned n = (BigUnsigned(1) << int(state.range(0))) - 1;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(isBPSWPrime(n));
+}
+BENCHMARK(BM_IsBPSWPrime)->Arg(521)->Arg(1279)->Arg(2203)->Unit(benchmark::kMicrosecond);
+
+// Random odd numbers, which are nearly all composite.
+static void BM_IsProbablePrimeRandom(benchmark::State& state)
+{
+    std::mt19937_64 rng(state.range(0));
+    std::vector<BigUnsigned> n;
+    for (int i = 0; i < 64; i++)
+        n.push_back(randomOdd(rng, BigUnsigned::Index(state.range(0))));
+    for (auto _ : state)
+        for (const BigUnsigned& x : n)
+            benchmark::DoNotOptimize(isProbablePrime(x, 10));
+}
+BENCHMARK(BM_IsProbablePrimeRandom)->Arg(8)->Arg(32)->Unit(benchmark::kMicrosecond);
+
+static void BM_NextPrime(benchmark::State& state)
+{
+    std::mt19937_64 rng(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        BigUnsigned n = randomOdd(rng, BigUnsigned::Index(state.range(0)));
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(nextPrime(n));
+    }
+}
+BENCHMARK(BM_NextPrime)->Arg(8)->Arg(16)->Arg(32)->Unit(benchmark::kMillisecond);
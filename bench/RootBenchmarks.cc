@@ -0,0 +1,54 @@
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <fbi/fbi.hh>
+
+#include "BenchmarkUtilities.hh"
+
+using namespace fbi;
+using namespace benchmarks;
+
+static void BM_SqrtRem(benchmark::State& state)
+{
+    std::mt19937_64 rng(state.range(0));
+    BigUnsigned n = randomBigUnsigned(rng, BigUnsigned::Index(state.range(0))), r;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(sqrtRem(n, r));
+}
+BENCHMARK(BM_SqrtRem)->Arg(2)->Arg(16)->Arg(128)->Arg(1024)->Unit(benchmark::kMicrosecond);
+
+// Random numbers, nearly all of which the residue filter rejects.
+static void BM_IsPerfectSquare(benchmark::State& state)
+{
+    std::mt19937_64 rng(state.range(0));
+    std::vector<BigUnsigned> n;
+    for (int i = 0; i < 64; i++)
+        n.push_back(randomBigUnsigned(rng, BigUnsigned::Index(state.range(0))));
+    for (auto _ : state)
+        for (const BigUnsigned& x : n)
+            benchmark::DoNotOptimize(isPerfectSquare(x));
+}
+BENCHMARK(BM_IsPerfectSquare)->Arg(16)->Arg(1024)->Unit(benchmark::kMicrosecond);
+
+static void BM_CubeRoot(benchmark::State& state)
+{
+    std::mt19937_64 rng(state.range(0));
+    BigUnsigned n = randomBigUnsigned(rng, BigUnsigned::Index(state.range(0)));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(iroot(n, 3));
+}
+BENCHMARK(BM_CubeRoot)->Arg(2)->Arg(16)->Arg(128)->Arg(1024)->Unit(benchmark::kMicrosecond);
+
+/* A random number, which is almost never a perfect power, so every prime
+ * exponent that its power of 2 allows is tried. */
+static void BM_IsPerfectPower(benchmark::State& state)
+{
+    std::mt19937_64 rng(state.range(0));
+    BigUnsigned n = randomBigUnsigned(rng, BigUnsigned::Index(state.range(0))), base;
+    BigUnsigned::Index exponent;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(isPerfectPower(n, base, exponent));
+}
+BENCHMARK(BM_IsPerfectPower)->Arg(2)->Arg(16)->Arg(128)->Unit(benchmark::kMicrosecond);
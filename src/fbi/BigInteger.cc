@@ -245,6 +245,18 @@ BigInteger::CmpRes BigInteger::compareTo(const BigInteger& x) const
         }
 }
 
+BigInteger::CmpRes BigInteger::compareToSmall(Sign s, Blk b) const
+{
+    if (sign < s)
+        return less;
+    else if (sign > s)
+        return greater;
+    else if (sign == zero)
+        return equal;
+    CmpRes m = mag.compareToSmall(b);
+    return (sign == positive) ? m : CmpRes(-m);
+}
+
 bool BigInteger::operator==(const BigUnsigned& x) const
 {
     return operator==(BigInteger{ x });
@@ -321,7 +333,6 @@ bool BigInteger::operator>(const BigInteger& x) const
 
 void BigInteger::add(const BigInteger& a, const BigInteger& b)
 {
-    DTRT_ALIASED(this == &a || this == &b, add(a, b));
     // If one argument is zero, copy the other.
     if (a.sign == zero)
         operator=(b);
@@ -359,7 +370,6 @@ void BigInteger::subtract(const BigInteger& a, const BigInteger& b)
 {
     // Notice that this routine is identical to BigInteger::add,
     // if one replaces b.sign by its opposite.
-    DTRT_ALIASED(this == &a || this == &b, subtract(a, b));
     // If a is zero, copy b and flip its sign.  If b is zero, copy a.
     if (a.sign == zero) {
         mag = b.mag;
@@ -520,16 +530,194 @@ void BigInteger::divideWithRemainder(const BigInteger& b, BigInteger& q)
     // WHEW!!!
 }
 
+void BigInteger::divideExact(const BigInteger& a, const BigInteger& b)
+{
+    DTRT_ALIASED(this == &a || this == &b, divideExact(a, b));
+    if (b.sign == zero)
+        throw DivideByZeroError{ "BigInteger::divideExact" };
+    mag.divideExact(a.mag, b.mag);
+    if (mag.isZero())
+        sign = zero;
+    else
+        sign = (a.sign == b.sign) ? positive : negative;
+}
+
 // Negation
 void BigInteger::negate(const BigInteger& a)
 {
-    DTRT_ALIASED(this == &a, negate(a));
     // Copy a's magnitude
     mag = a.mag;
     // Copy the opposite of a.sign
     sign = Sign(-a.sign);
 }
 
+/*
+ * SINGLE-BLOCK OPERATIONS
+ * Versions of the above for a second operand s b with a single-block
+ * magnitude b, for the operators that take primitive integers.  They work on
+ * the magnitude with BigUnsigned's single-block operations, which handle
+ * aliased calls in place.
+ */
+void BigInteger::addSmall(const BigInteger& a, Sign s, Blk b)
+{
+    if (b == 0) {
+        operator=(a);
+        return;
+    }
+    Sign aSign = a.sign;
+    if (aSign == zero || aSign == s) {
+        sign = s;
+        mag.addSmall(a.mag, b);
+        return;
+    }
+    switch (a.mag.compareToSmall(b)) {
+        case equal:
+            mag = 0;
+            sign = zero;
+            break;
+        case greater:
+            sign = aSign;
+            mag.subtractSmall(a.mag, b);
+            break;
+        case less: {
+            // Here a fits in one block.
+            Blk d = b - a.mag.getBlock(0);
+            sign = s;
+            mag = 0;
+            mag.setBlock(0, d);
+            break;
+        }
+    }
+}
+
+void BigInteger::multiplySmall(const BigInteger& a, Sign s, Blk b)
+{
+    if (a.sign == zero || b == 0) {
+        mag = 0;
+        sign = zero;
+        return;
+    }
+    sign = (a.sign == s) ? positive : negative;
+    mag.multiplySmall(a.mag, b);
+}
+
+// See divideWithRemainder for the rounding.
+BigInteger::Blk BigInteger::quotientSmall(const BigInteger& a, Sign s, Blk b)
+{
+    Sign aSign = a.sign;
+    Blk r = mag.quotientSmall(a.mag, b);
+    if (aSign != s && aSign != zero && r != 0) {
+        // Round the negative quotient down and take the remainder from |b|.
+        mag.addSmall(mag, 1);
+        r = b - r;
+    }
+    if (mag.isZero())
+        sign = zero;
+    else
+        sign = (aSign == s) ? positive : negative;
+    return r;
+}
+
+BigInteger::Blk BigInteger::modSmall(Sign s, Blk b) const
+{
+    Blk r = mag.modSmall(b);
+    if (sign != s && r != 0)
+        r = b - r;
+    return r;
+}
+
+/*
+ * FUSED MULTIPLY-ADD
+ * When *this and the product have the same sign, or *this is certainly the
+ * larger in magnitude, the product goes straight into the magnitude with
+ * BigUnsigned::addMul or subMul.  Otherwise the product is formed and added
+ * in the ordinary way, since the sign of the result isn't known in advance.
+ */
+void BigInteger::addProduct(Sign s, const BigUnsigned& x, const BigUnsigned& y)
+{
+    if (sign == zero) {
+        sign = s;
+        mag.multiply(x, y);
+    }
+    else if (sign == s)
+        mag.addMul(x, y);
+    else if (mag.getLength() > x.getLength() + y.getLength())
+        mag.subMul(x, y);
+    else {
+        BigUnsigned p;
+        p.multiply(x, y);
+        add(*this, BigInteger(p, s));
+    }
+}
+
+void BigInteger::addProductSmall(Sign s, const BigUnsigned& x, Blk y)
+{
+    if (sign == zero) {
+        sign = s;
+        mag = 0;
+        mag.addMulSmall(x, y);
+    }
+    else if (sign == s)
+        mag.addMulSmall(x, y);
+    else if (mag.getLength() > x.getLength() + 1)
+        mag.subMulSmall(x, y);
+    else {
+        BigUnsigned p;
+        p.addMulSmall(x, y);
+        add(*this, BigInteger(p, s));
+    }
+}
+
+void BigInteger::addMul(const BigInteger& a, const BigInteger& b)
+{
+    if (a.sign == zero || b.sign == zero)
+        return;
+    if (this == &a || this == &b) {
+        BigInteger product;
+        product.multiply(a, b);
+        add(*this, product);
+        return;
+    }
+    addProduct((a.sign == b.sign) ? positive : negative, a.mag, b.mag);
+}
+
+void BigInteger::subMul(const BigInteger& a, const BigInteger& b)
+{
+    if (a.sign == zero || b.sign == zero)
+        return;
+    if (this == &a || this == &b) {
+        BigInteger product;
+        product.multiply(a, b);
+        subtract(*this, product);
+        return;
+    }
+    addProduct((a.sign == b.sign) ? negative : positive, a.mag, b.mag);
+}
+
+void BigInteger::addMulSmall(const BigInteger& a, Blk b)
+{
+    if (a.sign == zero || b == 0)
+        return;
+    if (this == &a) {
+        BigInteger copy(a);
+        addProductSmall(copy.sign, copy.mag, b);
+        return;
+    }
+    addProductSmall(a.sign, a.mag, b);
+}
+
+void BigInteger::subMulSmall(const BigInteger& a, Blk b)
+{
+    if (a.sign == zero || b == 0)
+        return;
+    if (this == &a) {
+        BigInteger copy(a);
+        addProductSmall(Sign(-copy.sign), copy.mag, b);
+        return;
+    }
+    addProductSmall(Sign(-a.sign), a.mag, b);
+}
+
 /*
  * NORMAL OPERATORS
  *
@@ -699,7 +887,7 @@ BigInteger& BigInteger::operator++()
 {
     if (sign == negative) {
         mag--;
-        if (mag == 0)
+        if (mag.isZero())
             sign = zero;
     }
     else {
@@ -724,7 +912,7 @@ BigInteger& BigInteger::operator--()
 {
     if (sign == positive) {
         mag--;
-        if (mag == 0)
+        if (mag.isZero())
             sign = zero;
     }
     else {
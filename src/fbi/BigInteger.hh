@@ -150,7 +150,16 @@ public:
      * differ from those of primitive integers when negatives and/or zeros
      * are involved. */
     void divideWithRemainder(const BigInteger& b, BigInteger& q);
+    /* See BigUnsigned::divideExact.  Since b divides a, the quotient is
+     * exact and the rounding semantics of `/' do not matter. */
+    void divideExact(const BigInteger& a, const BigInteger& b);
     void negate(const BigInteger& a);
+    /* See BigUnsigned::addMul.  `r.addMul(a, b)' is like `r += a * b' and
+     * `r.subMul(a, b)' is like `r -= a * b'. */
+    void addMul(const BigInteger& a, const BigInteger& b);
+    void subMul(const BigInteger& a, const BigInteger& b);
+    void addMulSmall(const BigInteger& a, Blk b);
+    void subMulSmall(const BigInteger& a, Blk b);
 
     /* Bitwise operators are not provided for BigIntegers.  Use
      * getMagnitude to get the magnitude and operate on that instead. */
@@ -209,6 +218,23 @@ public:
     BigInteger operator++(int);
     BigInteger& operator--();
     BigInteger operator--(int);
+
+protected:
+    // Helpers for addMul and friends: *this += x * y, where x * y has sign s.
+    void addProduct(Sign s, const BigUnsigned& x, const BigUnsigned& y);
+    void addProductSmall(Sign s, const BigUnsigned& x, Blk y);
+
+    /* Helpers for the operators taking a primitive integer operand, which
+     * primitiveMagnitude splits into a sign s and a single-block magnitude b.
+     * `quotientSmall' stores a / (s b) and returns the magnitude of the
+     * remainder, whose sign is s; `modSmall' returns only the latter. */
+    template <class X>
+    static Blk primitiveMagnitude(X x, Sign& s);
+    CmpRes compareToSmall(Sign s, Blk b) const;
+    void addSmall(const BigInteger& a, Sign s, Blk b);
+    void multiplySmall(const BigInteger& a, Sign s, Blk b);
+    Blk quotientSmall(const BigInteger& a, Sign s, Blk b);
+    Blk modSmall(Sign s, Blk b) const;
 };
 
 #include "BigInteger.inl"
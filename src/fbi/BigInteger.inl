@@ -47,46 +47,72 @@ X BigInteger::convertToSignedPrimitive() const
     throw MathError{ "BigInteger::convertToSignedPrimitive", "Value is too big to fit in the requested type" };
 }
 
+template <class X>
+BigInteger::Blk BigInteger::primitiveMagnitude(X x, Sign& s)
+{
+    static_assert(std::is_integral<X>::value, "Integer type must be integral");
+    if constexpr (std::is_signed<X>::value)
+        if (x < 0) {
+            s = negative;
+            // Blk(0) - Blk(x), unlike -x, is right for the most negative X too.
+            return Blk(0) - Blk(x);
+        }
+    s = (x == 0) ? zero : positive;
+    return Blk(x);
+}
+
 template <typename Integer>
 bool BigInteger::operator==(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator==(BigInteger{ x });
+    Sign s;
+    Blk b = primitiveMagnitude(x, s);
+    return compareToSmall(s, b) == equal;
 }
 
 template <typename Integer>
 bool BigInteger::operator!=(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator!=(BigInteger{ x });
+    Sign s;
+    Blk b = primitiveMagnitude(x, s);
+    return compareToSmall(s, b) != equal;
 }
 
 template <typename Integer>
 bool BigInteger::operator<(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator<(BigInteger{ x });
+    Sign s;
+    Blk b = primitiveMagnitude(x, s);
+    return compareToSmall(s, b) == less;
 }
 
 template <typename Integer>
 bool BigInteger::operator<=(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator<=(BigInteger{ x });
+    Sign s;
+    Blk b = primitiveMagnitude(x, s);
+    return compareToSmall(s, b) != greater;
 }
 
 template <typename Integer>
 bool BigInteger::operator>=(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator>=(BigInteger{ x });
+    Sign s;
+    Blk b = primitiveMagnitude(x, s);
+    return compareToSmall(s, b) != less;
 }
 
 template <typename Integer>
 bool BigInteger::operator>(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator>(BigInteger{ x });
+    Sign s;
+    Blk b = primitiveMagnitude(x, s);
+    return compareToSmall(s, b) == greater;
 }
 
 // ======================================================================================== //
@@ -95,35 +121,57 @@ template <typename Integer>
 BigInteger BigInteger::operator+(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator+(BigInteger{ x });
+    Sign s;
+    Blk b = primitiveMagnitude(x, s);
+    BigInteger ans;
+    ans.addSmall(*this, s, b);
+    return ans;
 }
 
 template <typename Integer>
 BigInteger BigInteger::operator-(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator-(BigInteger{ x });
+    Sign s;
+    Blk b = primitiveMagnitude(x, s);
+    BigInteger ans;
+    ans.addSmall(*this, Sign(-s), b);
+    return ans;
 }
 
 template <typename Integer>
 BigInteger BigInteger::operator*(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator*(BigInteger{ x });
+    Sign s;
+    Blk b = primitiveMagnitude(x, s);
+    BigInteger ans;
+    ans.multiplySmall(*this, s, b);
+    return ans;
 }
 
 template <typename Integer>
 BigInteger BigInteger::operator/(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator/(BigInteger{ x });
+    Sign s;
+    Blk b = primitiveMagnitude(x, s);
+    if (b == 0)
+        throw DivideByZeroError{ "BigInteger::operator /" };
+    BigInteger ans;
+    ans.quotientSmall(*this, s, b);
+    return ans;
 }
 
 template <typename Integer>
 BigInteger BigInteger::operator%(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator%(BigInteger{ x });
+    Sign s;
+    Blk b = primitiveMagnitude(x, s);
+    if (b == 0)
+        throw DivideByZeroError{ "BigInteger::operator %" };
+    return BigInteger{ BigUnsigned{ modSmall(s, b) }, s };
 }
 
 // ======================================================================================== //
@@ -132,33 +180,55 @@ template <typename Integer>
 BigInteger& BigInteger::operator+=(const Integer& x)
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator+=(BigInteger{ x });
+    Sign s;
+    Blk b = primitiveMagnitude(x, s);
+    addSmall(*this, s, b);
+    return *this;
 }
 
 template <typename Integer>
 BigInteger& BigInteger::operator-=(const Integer& x)
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator-=(BigInteger{ x });
+    Sign s;
+    Blk b = primitiveMagnitude(x, s);
+    addSmall(*this, Sign(-s), b);
+    return *this;
 }
 
 template <typename Integer>
 BigInteger& BigInteger::operator*=(const Integer& x)
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator*=(BigInteger{ x });
+    Sign s;
+    Blk b = primitiveMagnitude(x, s);
+    multiplySmall(*this, s, b);
+    return *this;
 }
 
 template <typename Integer>
 BigInteger& BigInteger::operator/=(const Integer& x)
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator/=(BigInteger{ x });
+    Sign s;
+    Blk b = primitiveMagnitude(x, s);
+    if (b == 0)
+        throw DivideByZeroError{ "BigInteger::operator /=" };
+    quotientSmall(*this, s, b);
+    return *this;
 }
 
 template <typename Integer>
 BigInteger& BigInteger::operator%=(const Integer& x)
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator%=(BigInteger{ x });
-}
\ No newline at end of file
+    Sign s;
+    Blk b = primitiveMagnitude(x, s);
+    if (b == 0)
+        throw DivideByZeroError{ "BigInteger::operator %=" };
+    Blk r = modSmall(s, b);
+    mag = 0;
+    mag.setBlock(0, r);
+    sign = (r == 0) ? zero : s;
+    return *this;
+}
@@ -1,59 +1,1534 @@
 #include "BigIntegerAlgorithms.hh"
 
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <optional>
+#include <random>
 #include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "BlockArithmetic.hh"
+#include "MontgomeryContext.hh"
+#include "SpecialModulus.hh"
 
 namespace fbi {
-BigUnsigned gcd(BigUnsigned a, BigUnsigned b)
+namespace {
+typedef BigUnsigned::Blk Blk;
+typedef BigUnsigned::Index Index;
+
+/* Number of leading bits Lehmer's algorithm simulates in single precision.
+ * Two bits of headroom keep every intermediate value of the simulation
+ * (x + A, q * C, ...) inside a signed long long. */
+const Index lehmerDigitBits = BigUnsigned::N - 2;
+
+/* Operands with at least this many blocks are reduced with the recursive
+ * half-gcd algorithm; shorter ones go through Lehmer's algorithm. */
+const Index halfGcdThreshold = 50;
+
+/* iroot seeds Newton's method for roots of more than this many bits with
+ * the root of the top half of the number; shorter ones start from a
+ * floating-point estimate. */
+const Index rootSeedThreshold = 1024;
+
+/* modexp reduces special-form moduli of at least this many blocks by
+ * folding; shorter ones go through Montgomery multiplication. */
+const Index specialModulusThreshold = 10;
+
+/* blockProduct multiplies runs of at most this many blocks one block at a
+ * time; longer runs are split in half. */
+const std::size_t productLeafBlocks = 16;
+
+/* The primality tests divide by the odd primes below this bound before any
+ * exponentiation. */
+const Blk trialDivisionLimit = 1024;
+
+/* nextPrime and prevPrime sieve their candidates by the odd primes below a
+ * bound that grows with the length of the numbers, up to this one. */
+const Blk sieveLimit = 262144;
+
+// The number of odd candidates they sieve at a time.
+const Index sieveWindow = 4096;
+
+// Returns the block of (x >> shift) that starts at bit 0.
+Blk shiftedLowBlock(const BigUnsigned& x, Index shift)
 {
-    BigUnsigned trash;
-    // Neat in-place alternating technique.
-    for (;;) {
-        if (b.isZero())
-            return a;
-        a.divideWithRemainder(b, trash);
-        if (a.isZero())
-            return b;
-        b.divideWithRemainder(a, trash);
+    Index i = shift / BigUnsigned::N;
+    unsigned int bits = shift % BigUnsigned::N;
+    if (bits == 0)
+        return x.getBlock(i);
+    return (x.getBlock(i) >> bits) | (x.getBlock(i + 1) << (BigUnsigned::N - bits));
+}
+
+// r += u * x for a signed single-block cofactor u.
+void addMulSigned(BigInteger& r, const BigInteger& x, long long u)
+{
+    if (u < 0)
+        r.subMulSmall(x, Blk(0) - Blk(u));
+    else
+        r.addMulSmall(x, Blk(u));
+}
+
+/* Returns u * x + v * y, which the caller knows to be nonnegative.  In a
+ * Euclidean cofactor matrix u and v never have the same strict sign, so the
+ * result is one product minus the other. */
+BigUnsigned combineMagnitudes(const BigUnsigned& x, long long u, const BigUnsigned& y, long long v)
+{
+    BigUnsigned r;
+    if (u >= 0 && v >= 0) {
+        r.addMulSmall(x, Blk(u));
+        r.addMulSmall(y, Blk(v));
+    }
+    else if (u < 0) {
+        r.addMulSmall(y, Blk(v));
+        r.subMulSmall(x, Blk(0) - Blk(u));
     }
+    else {
+        r.addMulSmall(x, Blk(u));
+        r.subMulSmall(y, Blk(0) - Blk(v));
+    }
+    return r;
 }
 
-void extendedEuclidean(BigInteger m, BigInteger n, BigInteger& g, BigInteger& r, BigInteger& s)
+/* A reduction matrix M = (m00 m01; m10 m11): a product of Euclidean
+ * quotient matrices (q 1; 1 0) with q >= 1.  If (a; b) == M (alpha; beta)
+ * for some alpha > beta > 0, then alpha and beta are consecutive remainders
+ * in the Euclidean remainder sequence of a and b, and the q's are the
+ * quotients that lead there.  The determinant is -1 after an odd number of
+ * steps and 1 otherwise. */
+struct ReductionMatrix {
+    BigUnsigned m00, m01, m10, m11;
+    bool odd;
+
+    ReductionMatrix() : m00(1), m01(0), m10(0), m11(1), odd(false) {}
+
+    // After at least one step, m01 is a nonzero entry of the previous matrix.
+    bool isIdentity() const
+    {
+        return m01.isZero();
+    }
+
+    // M <- M (q 1; 1 0)
+    void step(const BigUnsigned& q)
+    {
+        m01.addMul(m00, q);
+        std::swap(m00, m01);
+        m11.addMul(m10, q);
+        std::swap(m10, m11);
+        odd = !odd;
+    }
+
+    /* M <- M S, where S is the matrix of `steps' single-precision Lehmer
+     * steps.  S is the inverse of (A B; C D), whose entries alternate in
+     * sign, so S == (|D| |B|; |C| |A|). */
+    void apply(long long A, long long B, long long C, long long D, unsigned int steps)
+    {
+        Blk s00 = Blk(D < 0 ? -D : D), s01 = Blk(B < 0 ? -B : B);
+        Blk s10 = Blk(C < 0 ? -C : C), s11 = Blk(A < 0 ? -A : A);
+        BigUnsigned t, u;
+        t.addMulSmall(m00, s00);
+        t.addMulSmall(m01, s10);
+        u.addMulSmall(m00, s01);
+        u.addMulSmall(m01, s11);
+        m00 = t;
+        m01 = u;
+        t = 0;
+        u = 0;
+        t.addMulSmall(m10, s00);
+        t.addMulSmall(m11, s10);
+        u.addMulSmall(m10, s01);
+        u.addMulSmall(m11, s11);
+        m10 = t;
+        m11 = u;
+        odd = (odd != (steps % 2 == 1));
+    }
+
+    // M <- M S
+    void multiply(const ReductionMatrix& S)
+    {
+        BigUnsigned t, u;
+        t.multiply(m00, S.m00);
+        t.addMul(m01, S.m10);
+        u.multiply(m00, S.m01);
+        u.addMul(m01, S.m11);
+        m00 = t;
+        m01 = u;
+        t.multiply(m10, S.m00);
+        t.addMul(m11, S.m10);
+        u.multiply(m10, S.m01);
+        u.addMul(m11, S.m11);
+        m10 = t;
+        m11 = u;
+        odd = (odd != S.odd);
+    }
+
+    /* Removes the last quotient matrix from M and returns its quotient q.
+     * Since M == M' (q 1; 1 0), each row of the first column is q times the
+     * second column plus the matching entry of M', which is at most the
+     * second column.  So each row gives q or q + 1, and one of them (the
+     * first row unless M has fewer than three steps) gives q exactly. */
+    BigUnsigned unstep()
+    {
+        BigUnsigned q, t;
+        bool haveQ = false;
+        if (!m01.isZero()) {
+            t = m00;
+            t.divideWithRemainder(m01, q);
+            haveQ = true;
+        }
+        if (!m11.isZero()) {
+            BigUnsigned q2;
+            t = m10;
+            t.divideWithRemainder(m11, q2);
+            if (!haveQ || q2 < q)
+                q = q2;
+        }
+        m00.subMul(m01, q);
+        std::swap(m00, m01);
+        m10.subMul(m11, q);
+        std::swap(m10, m11);
+        odd = !odd;
+        return q;
+    }
+
+    // Computes (alpha; beta) = M^(-1) (a; b) == det M (m11 -m01; -m10 m00) (a; b).
+    void reduce(const BigUnsigned& a, const BigUnsigned& b, BigInteger& alpha, BigInteger& beta) const
+    {
+        alpha = BigInteger(m11 * a) - BigInteger(m01 * b);
+        beta = BigInteger(m00 * b) - BigInteger(m10 * a);
+        if (odd) {
+            alpha.flipSign();
+            beta.flipSign();
+        }
+    }
+};
+
+/* One cofactor column of the extended Euclidean algorithm: `prev' and `cur'
+ * are the multipliers of one original input that produce the current pair of
+ * remainders (a, b). */
+struct Cofactors {
+    BigInteger prev;
+    BigInteger cur;
+
+    Cofactors(int p, int c) : prev(p), cur(c) {}
+
+    // Applies the single-precision matrix (A B; C D) to the column.
+    void apply(long long A, long long B, long long C, long long D)
+    {
+        BigInteger next, last;
+        addMulSigned(next, prev, C);
+        addMulSigned(next, cur, D);
+        addMulSigned(last, prev, A);
+        addMulSigned(last, cur, B);
+        prev = last;
+        cur = next;
+    }
+
+    // Applies the inverse of a reduction matrix to the column.
+    void apply(const ReductionMatrix& M)
+    {
+        BigInteger next, last;
+        next.multiply(cur, M.m00);
+        next.subMul(prev, M.m10);
+        last.multiply(prev, M.m11);
+        last.subMul(cur, M.m01);
+        prev = last;
+        cur = next;
+        if (M.odd) {
+            prev.flipSign();
+            cur.flipSign();
+        }
+    }
+
+    // Applies one ordinary Euclidean step with quotient q.
+    void step(const BigUnsigned& q)
+    {
+        prev.subMul(cur, q);
+        std::swap(prev, cur);
+    }
+};
+
+/* Runs Euclid on the leading `lehmerDigitBits' bits of a and b (Knuth,
+ * Algorithm 4.5.2L) and returns the number of quotients it could prove
+ * correct for the full numbers.  On return, the proved steps take (a, b) to
+ * (A a + B b, C a + D b).
+ *
+ * If `floorBits' is nonzero, the simulation also stops before any step whose
+ * new remainder might drop below 2^floorBits. */
+unsigned int simulateLeadingBits(
+    const BigUnsigned& a, const BigUnsigned& b, Index floorBits, long long& A, long long& B, long long& C, long long& D)
 {
-    if (&g == &r || &g == &s || &r == &s)
-        throw std::runtime_error{ "BigInteger extendedEuclidean: Outputs are aliased" };
-    BigInteger r1(1), s1(0), r2(0), s2(1), q;
-    /* Invariants:
-     * r1*m(orig) + s1*n(orig) == m(current)
-     * r2*m(orig) + s2*n(orig) == n(current) */
+    Index n = a.bitLength();
+    if (b.bitLength() > n)
+        n = b.bitLength();
+    Index shift = (n > lehmerDigitBits) ? n - lehmerDigitBits : 0;
+    long long x = (long long)shiftedLowBlock(a, shift);
+    long long y = (long long)shiftedLowBlock(b, shift);
+    /* The remainder y, C, D stands for lies between (y + C) 2^shift and
+     * (y + D) 2^shift, so a remainder of at least 2^floorBits is guaranteed
+     * once the smaller bound reaches `lowest'. */
+    long long lowest = 1;
+    if (floorBits > shift) {
+        if (floorBits - shift >= lehmerDigitBits)
+            return 0;
+        lowest = 1LL << (floorBits - shift);
+    }
+    unsigned int steps = 0;
+    A = 1;
+    B = 0;
+    C = 0;
+    D = 1;
     for (;;) {
-        if (n.isZero()) {
-            r = r1;
-            s = s1;
-            g = m;
-            return;
+        /* x + A and x + B bracket the leading digits of the current
+         * remainder, y + C and y + D those of the next one.  Give up as
+         * soon as the two extreme quotients disagree. */
+        if (y + C <= 0 || y + D <= 0)
+            break;
+        long long q = (x + A) / (y + C);
+        if (q != (x + B) / (y + D))
+            break;
+        long long nextC = A - q * C, nextD = B - q * D, nextY = x - q * y;
+        if (floorBits != 0 && nextY + (nextC < nextD ? nextC : nextD) < lowest)
+            break;
+        A = C;
+        C = nextC;
+        B = D;
+        D = nextD;
+        x = y;
+        y = nextY;
+        steps++;
+    }
+    return steps;
+}
+
+// One multiprecision Euclidean step: (a, b) <- (b, a mod b); returns a / b.
+BigUnsigned euclideanStep(BigUnsigned& a, BigUnsigned& b)
+{
+    BigUnsigned q, t = a;
+    t.divideWithRemainder(b, q);
+    a = b;
+    b = t;
+    return q;
+}
+
+/*
+ * Lehmer's extended Euclidean algorithm (Knuth, Algorithm 4.5.2L).
+ *
+ * On entry a and b are the magnitudes to reduce; on exit a holds their gcd
+ * and b is zero.  If r (resp. s) is not null, it tracks the cofactors of the
+ * original a (resp. b), so that at every point
+ *     r->prev * a(orig) + s->prev * b(orig) == a
+ *     r->cur  * a(orig) + s->cur  * b(orig) == b
+ *
+ * Instead of dividing the full numbers at every step, the algorithm runs
+ * Euclid on the leading bits of a and b, keeping the accumulated cofactor
+ * matrix in machine words.  The simulation stops as soon as the leading bits
+ * can no longer prove that a quotient is right; the matrix is then applied to
+ * the full numbers (and to the cofactors) in one batch.  Only when not even
+ * one quotient can be proved this way is a multiprecision division step
+ * taken.  The sequence of remainders, and therefore the result, is exactly
+ * that of the classic algorithm.
+ */
+void lehmerEuclid(BigUnsigned& a, BigUnsigned& b, Cofactors* r, Cofactors* s)
+{
+    BigUnsigned t;
+    long long A, B, C, D;
+    while (!b.isZero()) {
+        if (simulateLeadingBits(a, b, 0, A, B, C, D) == 0) {
+            BigUnsigned q = euclideanStep(a, b);
+            if (r != nullptr)
+                r->step(q);
+            if (s != nullptr)
+                s->step(q);
+        }
+        else {
+            t = combineMagnitudes(a, C, b, D);
+            a = combineMagnitudes(a, A, b, B);
+            b = t;
+            if (r != nullptr)
+                r->apply(A, B, C, D);
+            if (s != nullptr)
+                s->apply(A, B, C, D);
+        }
+    }
+}
+
+/* Given a >= b and a candidate reduction matrix M of a and b (typically one
+ * computed from their leading bits only), removes trailing quotients from M
+ * until M^(-1) (a; b) is a genuine pair of consecutive remainders, and stores
+ * that pair in (alpha, beta).  Only the last one or two quotients of a matrix
+ * computed from the leading half of the bits can be wrong. */
+void fixReduction(ReductionMatrix& M, const BigUnsigned& a, const BigUnsigned& b, BigUnsigned& alpha, BigUnsigned& beta)
+{
+    BigInteger x, y;
+    M.reduce(a, b, x, y);
+    while (!M.isIdentity() && !(y.getSign() == BigInteger::positive && x > y)) {
+        BigUnsigned q = M.unstep();
+        y.addMul(x, q);
+        std::swap(x, y);
+    }
+    alpha = x.getMagnitude();
+    beta = y.getMagnitude();
+}
+
+/* Continues the reduction M, (alpha, beta) of halfGcd with batches of Lehmer
+ * steps until beta < 2^m <= alpha. */
+void lehmerTowards(ReductionMatrix& M, BigUnsigned& alpha, BigUnsigned& beta, Index m)
+{
+    long long A, B, C, D;
+    while (beta.bitLength() > m) {
+        unsigned int steps = simulateLeadingBits(alpha, beta, m, A, B, C, D);
+        if (steps == 0)
+            M.step(euclideanStep(alpha, beta));
+        else {
+            BigUnsigned t = combineMagnitudes(alpha, C, beta, D);
+            alpha = combineMagnitudes(alpha, A, beta, B);
+            beta = t;
+            M.apply(A, B, C, D, steps);
         }
-        // Subtract q times the second invariant from the first invariant.
-        m.divideWithRemainder(n, q);
-        r1 -= q * r2;
-        s1 -= q * s2;
+    }
+}
 
-        if (m.isZero()) {
-            r = r2;
-            s = s2;
-            g = n;
+/*
+ * Half-gcd (Schoenhage's recursive algorithm, in the formulation of Thull and
+ * Yap).  Given a >= b, finds the reduction matrix M and the consecutive
+ * remainders (alpha, beta) == M^(-1) (a; b) that straddle 2^m, where m is
+ * half the bit length of a: alpha >= 2^m > beta.  If b < 2^m already, M is
+ * the identity.
+ *
+ * The top half of a and b determines the first half of the quotients, so M
+ * is built from two recursive calls on numbers of half the size, each
+ * followed by fixReduction, plus a few single steps.  With subquadratic
+ * multiplication this makes the whole gcd O(M(n) log n).
+ */
+void halfGcd(const BigUnsigned& a, const BigUnsigned& b, ReductionMatrix& M, BigUnsigned& alpha, BigUnsigned& beta)
+{
+    Index m = (a.bitLength() + 1) / 2;
+    M = ReductionMatrix();
+    alpha = a;
+    beta = b;
+    if (beta.bitLength() <= m)
+        return;
+
+    if (a.getLength() < halfGcdThreshold) {
+        lehmerTowards(M, alpha, beta, m);
+        return;
+    }
+
+    ReductionMatrix S;
+    BigUnsigned x, y;
+    // The top n - m bits take alpha down to about 3n/4 bits.
+    halfGcd(a >> m, b >> m, M, x, y);
+    fixReduction(M, a, b, alpha, beta);
+    if (beta.bitLength() > m)
+        M.step(euclideanStep(alpha, beta));
+    if (beta.bitLength() > m) {
+        /* Now alpha has l bits, m < l <= about 3n/4.  Its top 2 (l - m)
+         * bits determine the quotients that take it down to m bits. */
+        Index l = alpha.bitLength();
+        if (2 * (l - m) >= a.bitLength()) {
+            // The first half made no real progress; don't recurse forever.
+            lehmerTowards(M, alpha, beta, m);
             return;
         }
-        // Subtract q times the first invariant from the second invariant.
-        n.divideWithRemainder(m, q);
-        r2 -= q * r1;
-        s2 -= q * s1;
+        int k = int(2 * m - l);
+        halfGcd(alpha >> k, beta >> k, S, x, y);
+        BigUnsigned a2 = alpha, b2 = beta;
+        fixReduction(S, a2, b2, alpha, beta);
+        M.multiply(S);
+    }
+
+    // Take any last steps needed, or back up if we went too far.
+    while (beta.bitLength() > m)
+        M.step(euclideanStep(alpha, beta));
+    while (alpha.bitLength() <= m && !M.isIdentity()) {
+        BigUnsigned q = M.unstep();
+        beta.addMul(alpha, q);
+        std::swap(alpha, beta);
+    }
+}
+
+/* Reduces a and b to their gcd like lehmerEuclid, first taking big strides
+ * with halfGcd while the numbers are long enough for it to pay off. */
+void euclid(BigUnsigned& a, BigUnsigned& b, Cofactors* r, Cofactors* s)
+{
+    ReductionMatrix M;
+    BigUnsigned alpha, beta;
+    while (b.getLength() >= halfGcdThreshold) {
+        if (a >= b)
+            halfGcd(a, b, M, alpha, beta);
+        if (a < b || M.isIdentity()) {
+            // b is much shorter than a (or longer): a division step is cheaper.
+            BigUnsigned q = euclideanStep(a, b);
+            if (r != nullptr)
+                r->step(q);
+            if (s != nullptr)
+                s->step(q);
+            continue;
+        }
+        a = alpha;
+        b = beta;
+        if (r != nullptr)
+            r->apply(M);
+        if (s != nullptr)
+            s->apply(M);
+    }
+    lehmerEuclid(a, b, r, s);
+}
+
+// Transfers the sign of an input onto the cofactor computed for its magnitude.
+BigInteger signedCofactor(const BigInteger& cofactor, const BigInteger& input)
+{
+    if (input.getSign() == BigInteger::negative)
+        return -cofactor;
+    return cofactor;
+}
+
+// Returns x mod 2^bits.
+BigUnsigned lowBits(const BigUnsigned& x, BigUnsigned::Index bits)
+{
+    if (x.bitLength() <= bits)
+        return x;
+    Index blocks = (bits + BigUnsigned::N - 1) / BigUnsigned::N;
+    std::vector<Blk> r(blocks);
+    for (Index i = 0; i < blocks; i++)
+        r[i] = x.getBlock(i);
+    unsigned int topBits = unsigned(bits % BigUnsigned::N);
+    if (topBits != 0)
+        r[blocks - 1] &= (Blk(1) << topBits) - 1;
+    return BigUnsigned{ r.data(), blocks };
+}
+
+/* Returns (base ^ exponent) mod 2^bits.  Only the low bits of each product
+ * matter, so every intermediate result is truncated instead of divided. */
+BigUnsigned powerModPowerOfTwo(BigUnsigned base, BigUnsigned exponent, BigUnsigned::Index bits)
+{
+    base = lowBits(base, bits);
+    if (!base.getBit(0)) {
+        // base^exponent is a multiple of 2^exponent.
+        if (exponent >= BigUnsigned(bits))
+            return 0;
+    }
+    else if (bits > 1) {
+        // The odd residues modulo 2^bits form a group of order 2^(bits - 1).
+        exponent = lowBits(exponent, bits - 1);
+    }
+    BigUnsigned ans = lowBits(1, bits);
+    Index i = exponent.bitLength();
+    while (i > 0) {
+        i--;
+        ans = lowBits(ans * ans, bits);
+        if (exponent.getBit(i))
+            ans = lowBits(ans * base, bits);
+    }
+    return ans;
+}
+
+/* Returns the x < 2^k m with x == x1 (mod m) and x == x2 (mod 2^k), for
+ * odd m. */
+BigUnsigned combinePowerOfTwo(const BigUnsigned& x1, const BigUnsigned& m, const BigUnsigned& x2, Index k)
+{
+    if (m == 1)
+        return x2;
+    // x = x1 + m h with h = (x2 - x1) m^(-1) mod 2^k satisfies both congruences.
+    BigUnsigned twoK = BigUnsigned(1) << int(k);
+    BigUnsigned h = lowBits((x2 + twoK - lowBits(x1, k)) * modinv(m, twoK), k);
+    return x1 + m * h;
+}
+
+/* Returns an estimate of n^(1/k) from the leading 53 bits of n, for k >= 2
+ * and n > 0.  The estimate is accurate to about 50 bits; Newton's method
+ * takes it from there. */
+BigUnsigned rootEstimate(const BigUnsigned& n, Index k)
+{
+    Index length = n.bitLength();
+    Index shift = (length > 53) ? length - 53 : 0;
+    double log2n = std::log2(double(shiftedLowBlock(n, shift))) + double(shift);
+    double e = log2n / double(k);
+    if (e < 52)
+        return Blk(std::exp2(e)) + 1;
+    Index m = Index(e) - 52;
+    return BigUnsigned(Blk(std::exp2(e - double(m)))) << int(m);
+}
+
+// Returns a^e mod q for q < 2^32.
+Blk powModBlock(Blk a, Blk e, Blk q)
+{
+    Blk r = 1 % q;
+    a %= q;
+    for (; e != 0; e >>= 1) {
+        if (e & 1)
+            r = r * a % q;
+        a = a * a % q;
+    }
+    return r;
+}
+
+// Trial division, for the moduli of the perfect-power sieve beyond sieveLimit.
+bool isSmallPrime(Blk q)
+{
+    if (q < 2)
+        return false;
+    for (Blk d = 2; d * d <= q; d++)
+        if (q % d == 0)
+            return false;
+    return true;
+}
+
+// Returns floor(sqrt(n)) for a single block.
+Blk sqrtBlock(Blk n)
+{
+    // The double estimate is within one of the root; the loops fix it up.
+    const Blk maxRoot = (Blk(1) << (BigUnsigned::N / 2)) - 1;
+    Blk s = Blk(std::sqrt(double(n)));
+    while (s > maxRoot || s * s > n)
+        s--;
+    while (s < maxRoot && (s + 1) * (s + 1) <= n)
+        s++;
+    return s;
+}
+
+/* Karatsuba square root (Zimmermann).  For 4^(bits - 1) <= n < 4^bits,
+ * returns s = floor(sqrt(n)) and stores n - s^2 in r.  n is split as
+ * A 4^l + a1 2^l + a0 with l = bits / 2; the root s' of A, which has at least
+ * as many bits as 2^l, gives the top half of s, and one division of
+ * (r' 2^l + a1) by 2 s' gives the bottom half q.  Then n - s^2 is
+ * (u 2^l + a0) - q^2 for the remainder u of that division; if that is
+ * negative, s is one too big.  Costs a constant number of multiplications
+ * and divisions of the size of n. */
+BigUnsigned sqrtRemNormalized(const BigUnsigned& n, Index bits, BigUnsigned& r)
+{
+    if (bits <= BigUnsigned::N / 2) {
+        Blk v = n.getBlock(0), s = sqrtBlock(v);
+        r = v - s * s;
+        return s;
+    }
+    Index l = bits / 2;
+    BigUnsigned rh, q;
+    BigUnsigned sh = sqrtRemNormalized(n >> int(2 * l), bits - l, rh);
+    BigUnsigned u = (rh << int(l)) + lowBits(n >> int(l), l);
+    u.divideWithRemainder(sh << 1, q);
+    BigUnsigned s = (sh << int(l)) + q;
+    BigUnsigned t = (u << int(l)) + lowBits(n, l), q2;
+    q2.multiply(q, q);
+    while (t < q2) {
+        // (s - 1)^2 = s^2 - (2 s - 1).
+        t += (s << 1) - 1;
+        s -= 1;
+    }
+    r = t - q2;
+    return s;
+}
+
+/* Which residues modulo 64, 63, 65 and 11 squares can have.  Together they
+ * pass fewer than 1% of non-squares. */
+struct SquareResidues {
+    bool mod64[64] = {}, mod63[63] = {}, mod65[65] = {}, mod11[11] = {};
+
+    SquareResidues()
+    {
+        for (unsigned int i = 0; i < 65; i++) {
+            mod64[i * i % 64] = true;
+            mod63[i * i % 63] = true;
+            mod65[i * i % 65] = true;
+            mod11[i * i % 11] = true;
+        }
+    }
+};
+
+// Returns false if the residues of n rule out its being a square.
+bool mayBeSquare(const BigUnsigned& n)
+{
+    static const SquareResidues residues;
+    if (!residues.mod64[n.getBlock(0) % 64])
+        return false;
+    // One pass over n for all three odd moduli.
+    Blk m = n.modSmall(63 * 65 * 11);
+    return residues.mod63[m % 63] && residues.mod65[m % 65] && residues.mod11[m % 11];
+}
+
+/* Multiplication modulo an odd number on Montgomery-form block arrays,
+ * modulo a SpecialModulus by folding, and modulo 2^bits by truncation.
+ * multiExpWith is written against this small interface so both halves of an
+ * even modulus share the same algorithms. */
+class MontgomeryArithmetic {
+public:
+    typedef std::vector<Blk> Element;
+
+    explicit MontgomeryArithmetic(const BigUnsigned& modulus)
+        : context(modulus), scratch(2 * context.getLength())
+    {
+    }
+
+    Element load(const BigUnsigned& x) const
+    {
+        Element r(context.getLength());
+        context.load(r.data(), x);
+        return r;
+    }
+
+    BigUnsigned store(const Element& a) const
+    {
+        return context.store(a.data());
+    }
+
+    void multiply(Element& r, const Element& a, const Element& b)
+    {
+        context.multiplyBlocks(r.data(), a.data(), b.data(), scratch.data());
+    }
+
+private:
+    MontgomeryContext context;
+    std::vector<Blk> scratch;
+};
+
+class SpecialArithmetic {
+public:
+    typedef std::vector<Blk> Element;
+
+    explicit SpecialArithmetic(const SpecialModulus& modulus)
+        : modulus(modulus), scratch(4 * modulus.getLength() + 8)
+    {
+    }
+
+    Element load(const BigUnsigned& x) const
+    {
+        BigUnsigned r = modulus.reduce(x);
+        Element a(modulus.getLength());
+        for (Index i = 0; i < a.size(); i++)
+            a[i] = r.getBlock(i);
+        return a;
+    }
+
+    BigUnsigned store(const Element& a) const
+    {
+        return BigUnsigned{ a.data(), Index(a.size()) };
+    }
+
+    void multiply(Element& r, const Element& a, const Element& b)
+    {
+        modulus.multiplyBlocks(r.data(), a.data(), b.data(), scratch.data());
+    }
+
+private:
+    const SpecialModulus& modulus;
+    std::vector<Blk> scratch;
+};
+
+class TruncatedArithmetic {
+public:
+    typedef BigUnsigned Element;
+
+    explicit TruncatedArithmetic(Index bits) : bits(bits) {}
+
+    Element load(const BigUnsigned& x) const
+    {
+        return lowBits(x, bits);
+    }
+
+    BigUnsigned store(const Element& a) const
+    {
+        return a;
+    }
+
+    void multiply(Element& r, const Element& a, const Element& b)
+    {
+        r = lowBits(a * b, bits);
+    }
+
+private:
+    Index bits;
+};
+
+/* Returns the Pippenger digit width for count exponents of the given length
+ * and its cost in multiplications, not counting the shared squarings: each
+ * c-bit digit column sorts every base into one of 2^c - 1 buckets and then
+ * combines the buckets with about 2^(c + 1) multiplications. */
+unsigned int pippengerDigitBits(std::size_t count, Index bits, Index& cost)
+{
+    unsigned int best = 1;
+    cost = ~Index(0);
+    for (unsigned int c = 1; c <= 16; c++) {
+        Index c2 = (bits + c - 1) / c * (count + (Index(1) << (c + 1)));
+        if (c2 < cost) {
+            cost = c2;
+            best = c;
+        }
+    }
+    return best;
+}
+
+/* Straus's method: every base gets its own table of odd powers and sliding
+ * window decomposition, and the windows of all bases are multiplied into a
+ * single accumulator that shares one chain of squarings. */
+template <class Arithmetic>
+BigUnsigned strausMultiExp(Arithmetic& arith,
+                           const std::vector<BigUnsigned>& bases,
+                           const std::vector<BigUnsigned>& exponents)
+{
+    typedef typename Arithmetic::Element Element;
+    std::size_t count = bases.size();
+    std::vector<std::vector<Element>> tables(count);
+    std::vector<std::vector<detail::ExponentWindow>> windows(count);
+    std::vector<std::size_t> next(count, 0);
+    Index bits = 0;
+    for (std::size_t i = 0; i < count; i++) {
+        Index cost, length = exponents[i].bitLength();
+        unsigned int w = detail::slidingWindowBits(length, cost);
+        windows[i] = detail::slidingWindows(exponents[i], w);
+        if (windows[i].empty())
+            continue;
+        bits = std::max(bits, length);
+        // tables[i][v] = bases[i]^(2 v + 1)
+        Element square = arith.load(bases[i]);
+        tables[i].push_back(square);
+        arith.multiply(square, square, square);
+        for (Index v = 1; v < (Index(1) << (w - 1)); v++) {
+            tables[i].push_back(tables[i].back());
+            arith.multiply(tables[i].back(), tables[i].back(), square);
+        }
+    }
+
+    Element acc = arith.load(1);
+    bool started = false;
+    for (Index b = bits; b > 0; b--) {
+        if (started)
+            arith.multiply(acc, acc, acc);
+        for (std::size_t i = 0; i < count; i++) {
+            if (next[i] == windows[i].size() || windows[i][next[i]].position != b - 1)
+                continue;
+            const Element& entry = tables[i][windows[i][next[i]].value >> 1];
+            if (started)
+                arith.multiply(acc, acc, entry);
+            else
+                acc = entry;
+            started = true;
+            next[i]++;
+        }
+    }
+    return arith.store(acc);
+}
+
+/* Pippenger's bucket method: for each c-bit digit column, every base is
+ * multiplied into the bucket of its digit d, and the buckets B_d are then
+ * combined into the product of B_d^d with running products. */
+template <class Arithmetic>
+BigUnsigned pippengerMultiExp(Arithmetic& arith,
+                              const std::vector<BigUnsigned>& bases,
+                              const std::vector<BigUnsigned>& exponents,
+                              unsigned int c)
+{
+    typedef typename Arithmetic::Element Element;
+    std::size_t count = bases.size();
+    std::vector<Element> loaded;
+    Index bits = 0;
+    for (std::size_t i = 0; i < count; i++) {
+        loaded.push_back(arith.load(bases[i]));
+        bits = std::max(bits, exponents[i].bitLength());
+    }
+    Index buckets = Index(1) << c;
+    const Blk digitMask = Blk(buckets - 1);
+    std::vector<Element> bucket(buckets);
+    std::vector<bool> filled(buckets);
+
+    Element acc = arith.load(1), running, total;
+    bool started = false;
+    for (Index column = (bits + c - 1) / c; column > 0; column--) {
+        if (started)
+            for (unsigned int s = 0; s < c; s++)
+                arith.multiply(acc, acc, acc);
+        std::fill(filled.begin(), filled.end(), false);
+        for (std::size_t i = 0; i < count; i++) {
+            Index d = Index(shiftedLowBlock(exponents[i], (column - 1) * c) & digitMask);
+            if (d == 0)
+                continue;
+            if (filled[d])
+                arith.multiply(bucket[d], bucket[d], loaded[i]);
+            else
+                bucket[d] = loaded[i];
+            filled[d] = true;
+        }
+        // total = product of running over d, where running = product of B_e for e >= d.
+        bool haveRunning = false, haveTotal = false;
+        for (Index d = buckets - 1; d > 0; d--) {
+            if (filled[d]) {
+                if (haveRunning)
+                    arith.multiply(running, running, bucket[d]);
+                else
+                    running = bucket[d];
+                haveRunning = true;
+            }
+            if (!haveRunning)
+                continue;
+            if (haveTotal)
+                arith.multiply(total, total, running);
+            else
+                total = running;
+            haveTotal = true;
+        }
+        if (!haveTotal)
+            continue;
+        if (started)
+            arith.multiply(acc, acc, total);
+        else
+            acc = total;
+        started = true;
+    }
+    return arith.store(acc);
+}
+
+// Picks whichever of Straus and Pippenger needs fewer multiplications.
+template <class Arithmetic>
+BigUnsigned multiExpWith(Arithmetic& arith,
+                         const std::vector<BigUnsigned>& bases,
+                         const std::vector<BigUnsigned>& exponents)
+{
+    Index strausCost = 0, cost, bits = 0;
+    for (const BigUnsigned& e : exponents) {
+        detail::slidingWindowBits(e.bitLength(), cost);
+        strausCost += cost;
+        bits = std::max(bits, e.bitLength());
+    }
+    unsigned int c = pippengerDigitBits(bases.size(), bits, cost);
+    if (cost < strausCost)
+        return pippengerMultiExp(arith, bases, exponents, c);
+    return strausMultiExp(arith, bases, exponents);
+}
+
+/* Multiplies factors[0..count) in a balanced tree, so that the big
+ * multiplications pair operands of similar length, which is where Karatsuba's
+ * method pays off. */
+BigUnsigned treeProduct(const BigUnsigned* factors, std::size_t count)
+{
+    if (count == 0)
+        return 1;
+    if (count == 1)
+        return factors[0];
+    std::size_t half = count / 2;
+    BigUnsigned r;
+    r.multiply(treeProduct(factors, half), treeProduct(factors + half, count - half));
+    return r;
+}
+
+// The same for single-block factors.
+BigUnsigned blockProduct(const Blk* factors, std::size_t count)
+{
+    if (count <= productLeafBlocks) {
+        BigUnsigned r = 1;
+        for (std::size_t i = 0; i < count; i++)
+            r.multiplySmall(r, factors[i]);
+        return r;
+    }
+    std::size_t half = count / 2;
+    BigUnsigned r;
+    r.multiply(blockProduct(factors, half), blockProduct(factors + half, count - half));
+    return r;
+}
+
+/* Collects small factors for a product, multiplying them together in single
+ * blocks for as long as they fit, so that the product tree starts from full
+ * blocks rather than from one small factor per leaf. */
+class FactorPacker {
+public:
+    void add(Blk factor)
+    {
+        Blk high;
+        Blk low = detail::mulBlocks(current, factor, high);
+        if (high != 0) {
+            packed.push_back(current);
+            current = factor;
+        } else
+            current = low;
+    }
+
+    // Returns the product of the factors added since the last call.
+    BigUnsigned product()
+    {
+        packed.push_back(current);
+        BigUnsigned r = blockProduct(packed.data(), packed.size());
+        packed.clear();
+        current = 1;
+        return r;
+    }
+
+private:
+    Blk current = 1;
+    std::vector<Blk> packed;
+};
+
+// Returns the primes up to n, by the sieve of Eratosthenes on odd numbers.
+std::vector<Index> primesUpTo(Index n)
+{
+    std::vector<Index> primes;
+    if (n < 2)
+        return primes;
+    primes.push_back(2);
+    // composite[i] stands for 2 i + 1.
+    Index half = (n - 1) / 2;
+    std::vector<bool> composite(half + std::size_t(1));
+    for (Index i = 1; i <= half; i++) {
+        if (composite[i])
+            continue;
+        std::uint64_t p = 2 * std::uint64_t(i) + 1;
+        primes.push_back(Index(p));
+        for (std::uint64_t j = (p * p - 1) / 2; j <= half; j += p)
+            composite[j] = true;
+    }
+    return primes;
+}
+
+// The exponent of the prime p in n!, by Legendre's formula.
+Index factorialExponent(Index n, Index p)
+{
+    Index e = 0;
+    while (n >= p) {
+        n /= p;
+        e += n;
+    }
+    return e;
+}
+
+/* Returns the product of primes[i] ^ exponents[i].  With P_j the product of
+ * the primes whose exponent has bit j set, that is
+ * (...(P_top^2 P_(top-1))^2 ...)^2 P_0: a handful of products of packed
+ * primes and as many squarings as the largest exponent has bits. */
+BigUnsigned primePowerProduct(const std::vector<Index>& primes, const std::vector<Index>& exponents)
+{
+    Index largest = 0;
+    for (Index e : exponents)
+        largest = std::max(largest, e);
+    int bits = 0;
+    while ((largest >> bits) != 0)
+        bits++;
+    BigUnsigned r = 1;
+    FactorPacker packer;
+    for (int bit = bits - 1; bit >= 0; bit--) {
+        for (std::size_t i = 0; i < primes.size(); i++)
+            if ((exponents[i] >> bit) & 1)
+                packer.add(primes[i]);
+        r.multiply(r, r);
+        r.multiply(r, packer.product());
+    }
+    return r;
+}
+
+/* The odd part of the swinging factorial n! / floor(n/2)!^2.  The exponent
+ * of an odd prime p in it is the number of odd terms floor(n / p^i), so
+ * primes above sqrt(n) appear at most once and those between n/3 and n/2 not
+ * at all.  primes must hold every prime up to n. */
+BigUnsigned oddSwing(Index n, const std::vector<Index>& primes)
+{
+    Blk root = sqrtBlock(n);
+    FactorPacker packer;
+    for (std::size_t i = 1; i < primes.size() && primes[i] <= n; i++) {
+        Index p = primes[i];
+        if (p <= root) {
+            // p^e <= n, since p^i <= n for every term counted.
+            Index q = n, power = 1;
+            while ((q /= p) > 0)
+                if (q & 1)
+                    power *= p;
+            packer.add(power);
+        } else if ((n / p) & 1)
+            packer.add(p);
+    }
+    return packer.product();
+}
+
+/* The odd part of n!.  By the prime-swing recursion (Schoenhage, Luschny),
+ * n! = floor(n/2)!^2 swing(n), and the same holds for the odd parts. */
+BigUnsigned oddFactorial(Index n, const std::vector<Index>& primes)
+{
+    if (n < 3)
+        return 1;
+    BigUnsigned r = oddFactorial(n / 2, primes);
+    r.multiply(r, r);
+    r.multiply(r, oddSwing(n, primes));
+    return r;
+}
+
+/* Throws a MathError if n! has more than INT_MAX bits, as shift amounts are
+ * ints.  Uses Stirling's bound ln n! <= (n + 1/2) ln n - n + 1 rather than
+ * lgamma, which is not thread-safe. */
+void checkFactorialSize(const char* who, Index n)
+{
+    double x = double(n);
+    if (n > 1 && ((x + 0.5) * std::log(x) - x + 1) / std::log(2.0) >= double(INT_MAX))
+        throw MathError{ who, "Result too large" };
+}
+
+/* The odd primes below sieveLimit, grouped into runs whose products fit in
+ * a block.  One pass over the blocks of a number then yields its residues
+ * modulo every run at once, or modulo the runs of the smallest primes. */
+struct SmallPrimeTable {
+    std::vector<Blk> primes, moduli;
+    // The primes dividing moduli[j] are primes[ends[j - 1]..ends[j]).
+    std::vector<std::size_t> ends;
+
+    SmallPrimeTable()
+    {
+        Blk modulus = 1;
+        for (Index p : primesUpTo(Index(sieveLimit - 1))) {
+            if (p == 2)
+                continue;
+            Blk high;
+            Blk product = detail::mulBlocks(modulus, p, high);
+            if (high != 0) {
+                moduli.push_back(modulus);
+                ends.push_back(primes.size());
+                product = p;
+            }
+            modulus = product;
+            primes.push_back(p);
+        }
+        moduli.push_back(modulus);
+        ends.push_back(primes.size());
+    }
+
+    // The number of runs needed to cover the primes below limit.
+    std::size_t runsBelow(Blk limit) const
+    {
+        std::size_t j = 0;
+        while (j < moduli.size() && primes[j == 0 ? 0 : ends[j - 1]] < limit)
+            j++;
+        return j;
+    }
+
+    /* Stores n mod moduli[j] in residues[j] for j < runs.  The divisions for
+     * the different runs are independent, so the processor overlaps them. */
+    void reduce(const BigUnsigned& n, std::size_t runs, Blk* residues) const
+    {
+        std::fill(residues, residues + runs, 0);
+        for (Index i = n.getLength(); i-- > 0;) {
+            Blk b = n.getBlock(i);
+            for (std::size_t j = 0; j < runs; j++)
+                detail::divBlocks(residues[j], b, moduli[j], residues[j]);
+        }
+    }
+};
+
+const SmallPrimeTable& smallPrimeTable()
+{
+    static const SmallPrimeTable table;
+    return table;
+}
+
+// Returns whether the odd number q > 1 is prime, looking it up if q < sieveLimit.
+bool isOddPrime(Blk q)
+{
+    if (q >= sieveLimit)
+        return isSmallPrime(q);
+    const std::vector<Blk>& primes = smallPrimeTable().primes;
+    return std::binary_search(primes.begin(), primes.end(), q);
+}
+
+/* Returns false if n can't be a p-th power for the prime p > 2, judging by
+ * its residues modulo a few primes q == 1 (mod p).  Modulo such a q only
+ * one residue in p is a nonzero p-th power, that is a with
+ * a^((q - 1) / p) == 1, so each q rejects all but about 1/p of non-powers. */
+bool mayBePower(const BigUnsigned& n, Index p)
+{
+    const int sieveModuli = 4;
+    int found = 0;
+    for (Blk q = 2 * Blk(p) + 1; found < sieveModuli && q < (Blk(1) << 32); q += 2 * Blk(p)) {
+        if (!isOddPrime(q))
+            continue;
+        found++;
+        Blk a = n.modSmall(q);
+        if (a != 0 && powModBlock(a, (q - 1) / p, q) != 1)
+            return false;
+    }
+    return true;
+}
+
+/* If n is a p-th power for the prime p, stores its root in root and returns
+ * true. */
+bool isPrimePower(const BigUnsigned& n, Index p, BigUnsigned& root)
+{
+    if (p == 2) {
+        if (!mayBeSquare(n))
+            return false;
+        BigUnsigned r;
+        root = sqrtRem(n, r);
+        return r.isZero();
+    }
+    if (!mayBePower(n, p))
+        return false;
+    root = iroot(n, p);
+    return pow(root, p) == n;
+}
+
+/* Returns the smallest odd prime factor of n below trialDivisionLimit, or 0
+ * if there is none. */
+Blk smallOddFactor(const BigUnsigned& n)
+{
+    const SmallPrimeTable& table = smallPrimeTable();
+    static const std::size_t runs = table.runsBelow(trialDivisionLimit);
+    std::vector<Blk> residues(runs);
+    table.reduce(n, runs, residues.data());
+    std::size_t k = 0;
+    for (std::size_t j = 0; j < runs; j++)
+        for (; k < table.ends[j] && table.primes[k] < trialDivisionLimit; k++)
+            if (residues[j] % table.primes[k] == 0)
+                return table.primes[k];
+    return 0;
+}
+
+// Returns a b mod m, for a, b < m.
+Blk mulModBlock(Blk a, Blk b, Blk m)
+{
+    Blk high, r;
+    Blk low = detail::mulBlocks(a, b, high);
+    detail::divBlocks(high, low, m, r);
+    return r;
+}
+
+/* Returns whether the odd n > 2 is a strong probable prime to base a: with
+ * n - 1 = d 2^s and d odd, either a^d == 1 or a^(d 2^r) == -1 (mod n) for
+ * some r < s.  Multiples of n count as passing. */
+bool isStrongProbablePrimeBlock(Blk n, Blk a)
+{
+    a %= n;
+    if (a == 0)
+        return true;
+    unsigned int s = detail::trailingZeros(n - 1);
+    Blk x = 1;
+    for (Blk e = (n - 1) >> s; e != 0; e >>= 1) {
+        if (e & 1)
+            x = mulModBlock(x, a, n);
+        a = mulModBlock(a, a, n);
+    }
+    if (x == 1 || x == n - 1)
+        return true;
+    for (unsigned int r = 1; r < s; r++) {
+        x = mulModBlock(x, x, n);
+        if (x == n - 1)
+            return true;
+    }
+    return false;
+}
+
+/* Returns whether the odd n > 2 is prime.  No composite below 2^64 is a
+ * strong probable prime to all seven of these bases (Sinclair). */
+bool isPrimeBlock(Blk n)
+{
+    static const Blk bases[] = { 2, 325, 9375, 28178, 450775, 9780504, 1795265022 };
+    for (Blk a : bases)
+        if (!isStrongProbablePrimeBlock(n, a))
+            return false;
+    return true;
+}
+
+/* Strong probable prime tests for a fixed odd n, to any number of bases.
+ * The bases share one Montgomery context, and the squarings after the
+ * exponentiation run in Montgomery form on block arrays. */
+class MillerRabin {
+public:
+    explicit MillerRabin(const BigUnsigned& n)
+        : context(n), nMinusOne(n - 1), s(nMinusOne.trailingZeros()), d(nMinusOne >> int(s)),
+          x(context.getLength()), minusOne(context.getLength()), scratch(2 * context.getLength())
+    {
+        context.load(minusOne.data(), nMinusOne);
+    }
+
+    bool isStrongProbablePrime(const BigUnsigned& a)
+    {
+        BigUnsigned y = context.exp(a, d);
+        if (y == 1 || y == nMinusOne)
+            return true;
+        context.load(x.data(), y);
+        for (Index r = 1; r < s; r++) {
+            context.multiplyBlocks(x.data(), x.data(), x.data(), scratch.data());
+            if (x == minusOne)
+                return true;
+        }
+        return false;
     }
+
+private:
+    MontgomeryContext context;
+    BigUnsigned nMinusOne;
+    Index s;
+    BigUnsigned d;
+    std::vector<Blk> x, minusOne, scratch;
+};
+
+// The Jacobi symbol (a/m), for odd m.
+int jacobiBlock(Blk a, Blk m)
+{
+    int r = 1;
+    a %= m;
+    while (a != 0) {
+        while (a % 2 == 0) {
+            a /= 2;
+            if (m % 8 == 3 || m % 8 == 5)
+                r = -r;
+        }
+        std::swap(a, m);
+        if (a % 4 == 3 && m % 4 == 3)
+            r = -r;
+        a %= m;
+    }
+    return m == 1 ? r : 0;
+}
+
+/* The Jacobi symbol (D/n), for odd D and odd n.  By quadratic reciprocity
+ * it depends only on n mod |D| and n mod 4. */
+int jacobi(long long D, const BigUnsigned& n)
+{
+    Blk a = Blk(D < 0 ? -D : D), n4 = n.getBlock(0) % 4;
+    int r = jacobiBlock(n.modSmall(a), a);
+    if (a % 4 == 3 && n4 == 3)
+        r = -r;
+    if (D < 0 && n4 == 3)
+        r = -r;
+    return r;
+}
+
+/* Montgomery-form arithmetic modulo an odd n on block arrays of n's length,
+ * for the Lucas test, which mixes its products with additions and
+ * multiplications by small constants. */
+class LucasArithmetic {
+public:
+    typedef std::vector<Blk> Element;
+
+    explicit LucasArithmetic(const BigUnsigned& modulus)
+        : context(modulus), k(context.getLength()), n(k), scratch(2 * k)
+    {
+        for (Index i = 0; i < k; i++)
+            n[i] = modulus.getBlock(i);
+    }
+
+    // The Montgomery form of c mod n.
+    Element load(long long c) const
+    {
+        Element r(k);
+        context.load(r.data(), Blk(c < 0 ? -c : c));
+        if (c < 0)
+            negate(r);
+        return r;
+    }
+
+    void multiply(Element& r, const Element& a, const Element& b)
+    {
+        context.multiplyBlocks(r.data(), a.data(), b.data(), scratch.data());
+    }
+
+    void add(Element& r, const Element& a, const Element& b)
+    {
+        Blk carry = detail::addBlocks(r.data(), a.data(), b.data(), k);
+        Blk borrow = detail::subtractBlocks(scratch.data(), r.data(), n.data(), k);
+        if (carry != 0 || borrow == 0)
+            std::copy(scratch.begin(), scratch.begin() + k, r.begin());
+    }
+
+    void subtract(Element& r, const Element& a, const Element& b)
+    {
+        if (detail::subtractBlocks(r.data(), a.data(), b.data(), k) != 0)
+            detail::addBlocks(r.data(), r.data(), n.data(), k);
+    }
+
+    /* r = c a.  The product has a single-block quotient by n, so an ordinary
+     * division costs much less than a Montgomery product would. */
+    void multiplySmall(Element& r, const Element& a, long long c) const
+    {
+        BigUnsigned x(a.data(), k);
+        x.multiplySmall(x, Blk(c < 0 ? -c : c));
+        x %= context.getModulus();
+        for (Index i = 0; i < k; i++)
+            r[i] = x.getBlock(i);
+        if (c < 0)
+            negate(r);
+    }
+
+    static bool isZero(const Element& a)
+    {
+        return std::all_of(a.begin(), a.end(), [](Blk b) { return b == 0; });
+    }
+
+private:
+    void negate(Element& r) const
+    {
+        if (!isZero(r))
+            detail::subtractBlocks(r.data(), n.data(), r.data(), k);
+    }
+
+    MontgomeryContext context;
+    Index k;
+    std::vector<Blk> n, scratch;
+};
+
+/* Strong Lucas probable prime test with Selfridge's parameters: D is the
+ * first of 5, -7, 9, -11, ... with (D/n) == -1, P = 1 and Q = (1 - D) / 4.
+ * With n + 1 = d 2^s and d odd, n passes if U_d == 0 or V_(d 2^r) == 0
+ * (mod n) for some r < s.
+ *
+ * V_d and V_(d+1) come from a Lucas chain on the bits of d, with
+ * V_2k = V_k^2 - 2 Q^k and V_(2k+1) = V_k V_(k+1) - Q^k: three Montgomery
+ * products per bit, counting the one for Q^k.  U_d is not computed, since
+ * D U_d = 2 V_(d+1) - V_d and D is prime to n.  n must be odd, not a square
+ * (or no D exists) and have no prime factor below trialDivisionLimit. */
+bool isStrongLucasProbablePrime(const BigUnsigned& n)
+{
+    long long D = 5;
+    for (;; D = (D > 0) ? -(D + 2) : 2 - D) {
+        int j = jacobi(D, n);
+        if (j == -1)
+            break;
+        // |D| is less than n, so this means they share a factor.
+        if (j == 0)
+            return false;
+    }
+    long long Q = (1 - D) / 4;
+    LucasArithmetic arith(n);
+
+    BigUnsigned nPlusOne = n + 1;
+    Index s = nPlusOne.trailingZeros();
+    BigUnsigned d = nPlusOne >> int(s);
+    // v0 = V_k, v1 = V_(k+1) and qk = Q^k, from k = 1.
+    LucasArithmetic::Element v0 = arith.load(1), v1 = arith.load(1 - 2 * Q), qk = arith.load(Q), t = qk;
+    for (Index i = d.bitLength() - 1; i-- > 0;) {
+        if (d.getBit(i)) {
+            // k <- 2k + 1
+            arith.multiply(v0, v0, v1);
+            arith.subtract(v0, v0, qk);
+            arith.multiplySmall(t, qk, Q);
+            arith.multiply(v1, v1, v1);
+            arith.subtract(v1, v1, t);
+            arith.subtract(v1, v1, t);
+            arith.multiply(qk, qk, t);
+        } else {
+            // k <- 2k
+            arith.multiply(v1, v0, v1);
+            arith.subtract(v1, v1, qk);
+            arith.multiply(v0, v0, v0);
+            arith.subtract(v0, v0, qk);
+            arith.subtract(v0, v0, qk);
+            arith.multiply(qk, qk, qk);
+        }
+    }
+    arith.add(t, v1, v1);
+    if (t == v0)
+        return true;
+    for (Index r = 0; r < s; r++) {
+        if (LucasArithmetic::isZero(v0))
+            return true;
+        arith.multiply(v0, v0, v0);
+        arith.subtract(v0, v0, qk);
+        arith.subtract(v0, v0, qk);
+        arith.multiply(qk, qk, qk);
+    }
+    return false;
+}
+
+/* The checks both primality tests start with.  Returns 1 for a prime, 0 for
+ * a composite and -1 if n is odd, above 2^N and free of small factors, so
+ * that it needs probable prime tests. */
+int trialDivision(const BigUnsigned& n)
+{
+    if (n < 2)
+        return 0;
+    if (!n.getBit(0))
+        return n == 2;
+    Blk f = smallOddFactor(n);
+    if (f != 0)
+        return n == f;
+    if (n.getLength() > 1)
+        return -1;
+    Blk m = n.getBlock(0);
+    return m < trialDivisionLimit * trialDivisionLimit || isPrimeBlock(m);
+}
+
+/* The Baillie-PSW test proper, for odd n above 2^N with no prime factor
+ * below trialDivisionLimit. */
+bool isBPSWProbablePrime(const BigUnsigned& n)
+{
+    return MillerRabin(n).isStrongProbablePrime(2) && !isPerfectSquare(n) && isStrongLucasProbablePrime(n);
+}
+
+/*
+ * Returns the first prime among start, start + 2, start + 4, ..., or among
+ * start, start - 2, start - 4, ... if down is set, for odd start >= 2^32.
+ * Windows of sieveWindow candidates are sieved by the odd primes below a
+ * bound that grows with the length of start, so that the sieve stays cheap
+ * next to the tests it saves.  One multi-residue pass over start gives each
+ * prime's offset, the index of the first candidate it divides, and from
+ * then on the offsets just move from window to window.  Only the
+ * candidates left are tested.  No prime below the bound can cross out
+ * itself, since those primes are far below 2^32.
+ */
+BigUnsigned sieveForPrime(const BigUnsigned& start, bool down)
+{
+    const SmallPrimeTable& table = smallPrimeTable();
+    Blk limit = std::min(std::max(Blk(128) * start.bitLength(), trialDivisionLimit), sieveLimit);
+    std::size_t runs = table.runsBelow(limit), count = table.ends[runs - 1];
+    std::vector<Blk> residues(runs);
+    table.reduce(start, runs, residues.data());
+    std::vector<Index> offsets(count);
+    for (std::size_t j = 0, i = 0; j < runs; j++)
+        for (; i < table.ends[j]; i++) {
+            // start + 2 x == 0 (mod p) for x == -r / 2, and 1 / 2 == (p + 1) / 2.
+            Blk p = table.primes[i], r = residues[j] % p;
+            offsets[i] = Index((down ? r : p - r) % p * ((p + 1) / 2) % p);
+        }
+
+    std::vector<bool> composite(sieveWindow);
+    for (Blk base = 0;; base += sieveWindow) {
+        std::fill(composite.begin(), composite.end(), false);
+        for (std::size_t i = 0; i < count; i++) {
+            Index p = Index(table.primes[i]), x = offsets[i];
+            for (; x < sieveWindow; x += p)
+                composite[x] = true;
+            offsets[i] = x - sieveWindow;
+        }
+        for (Index x = 0; x < sieveWindow; x++) {
+            if (composite[x])
+                continue;
+            Blk step = 2 * (base + x);
+            BigUnsigned c = down ? start - step : start + step;
+            if (c.getLength() == 1 ? isPrimeBlock(c.getBlock(0)) : isBPSWProbablePrime(c))
+                return c;
+        }
+    }
+}
+} // namespace
+
+BigUnsigned gcd(BigUnsigned a, BigUnsigned b)
+{
+    euclid(a, b, nullptr, nullptr);
+    return a;
+}
+
+void extendedEuclidean(const BigInteger& m, const BigInteger& n, BigInteger& g, BigInteger& r, BigInteger& s)
+{
+    if (&g == &r || &g == &s || &r == &s)
+        throw std::runtime_error{ "BigInteger extendedEuclidean: Outputs are aliased" };
+    BigUnsigned a = m.getMagnitude(), b = n.getMagnitude();
+    Cofactors rc(1, 0), sc(0, 1);
+    euclid(a, b, &rc, &sc);
+    // Write the outputs last: they may alias the inputs.
+    r = signedCofactor(rc.prev, m);
+    s = signedCofactor(sc.prev, n);
+    g = a;
+}
+
+void extendedEuclidean(const BigInteger& m, const BigInteger& n, BigInteger& g, BigInteger& r)
+{
+    if (&g == &r)
+        throw std::runtime_error{ "BigInteger extendedEuclidean: Outputs are aliased" };
+    BigUnsigned a = m.getMagnitude(), b = n.getMagnitude();
+    Cofactors rc(1, 0);
+    euclid(a, b, &rc, nullptr);
+    r = signedCofactor(rc.prev, m);
+    g = a;
 }
 
 BigUnsigned modinv(const BigInteger& x, const BigUnsigned& n)
 {
-    BigInteger g, r, s;
-    extendedEuclidean(x, n, g, r, s);
+    BigInteger g, r;
+    // Only the cofactor of x is needed; skip the one of n.
+    extendedEuclidean(x, n, g, r);
     if (g == 1)
         // r*x + s*n == 1, so r*x === 1 (mod n), so r is the answer.
         return (r % n).getMagnitude(); // (r % n) will be nonnegative
@@ -61,22 +1536,449 @@ BigUnsigned modinv(const BigInteger& x, const BigUnsigned& n)
         throw std::runtime_error{ "BigInteger modinv: x and n have a common factor" };
 }
 
+std::vector<BigUnsigned> batchModinv(const BigUnsigned* xs,
+                                     std::size_t count,
+                                     const BigUnsigned& n,
+                                     std::vector<bool>& invertible)
+{
+    if (n.isZero())
+        throw DivideByZeroError{ "BigInteger batchModinv" };
+    invertible.assign(count, true);
+    // The inverses are built in place of the prefix products.
+    std::vector<BigUnsigned> inverses(count);
+    if (count == 0)
+        return inverses;
+
+    BigUnsigned q, t, acc;
+    for (;;) {
+        /* inverses[i] = product of the invertible xs[0..i] mod n.  An element
+         * that is 0 mod n is certainly not invertible (unless n == 1, where
+         * everything is 0 and its own inverse). */
+        acc = 1;
+        for (std::size_t i = 0; i < count; i++) {
+            if (invertible[i]) {
+                t.multiply(acc, xs[i]);
+                t.divideWithRemainder(n, q);
+                if (t.isZero() && n != 1)
+                    invertible[i] = false;
+                else
+                    acc = t;
+            }
+            inverses[i] = acc;
+        }
+        BigInteger g, r;
+        extendedEuclidean(acc, n, g, r);
+        if (g == 1) {
+            acc = (r % n).getMagnitude();
+            break;
+        }
+        /* Some element shares a factor with n.  Find the culprits, which
+         * only costs anything when the batch has bad elements, and retry. */
+        for (std::size_t i = 0; i < count; i++)
+            if (invertible[i] && gcd(xs[i], n) != 1)
+                invertible[i] = false;
+    }
+
+    /* Now acc is the inverse of the whole product.  Walking backwards,
+     * acc * (product of the elements before i) is the inverse of xs[i], and
+     * multiplying acc by xs[i] strips xs[i] from it. */
+    for (std::size_t i = count; i > 0;) {
+        i--;
+        if (!invertible[i]) {
+            inverses[i] = 0;
+            continue;
+        }
+        // inverses[i - 1] still holds the product of the elements before i.
+        if (i == 0)
+            t = acc;
+        else {
+            t.multiply(acc, inverses[i - 1]);
+            t.divideWithRemainder(n, q);
+        }
+        acc.multiply(acc, xs[i]);
+        acc.divideWithRemainder(n, q);
+        inverses[i] = t;
+    }
+    return inverses;
+}
+
+/*
+ * Moduli of the form 2^k - c or 2^k + c with a small c are reduced by
+ * folding (see SpecialModulus) once they are long enough for that to beat
+ * Montgomery multiplication.
+ *
+ * Montgomery arithmetic needs an odd modulus, so an even modulus is split as
+ * 2^k m with m odd.  The power is computed modulo m with Montgomery
+ * arithmetic and modulo 2^k by truncating every product to its low k bits;
+ * the Chinese remainder theorem then recombines the two residues.
+ */
 BigUnsigned modexp(const BigInteger& base, const BigUnsigned& exponent, const BigUnsigned& modulus)
 {
-    BigUnsigned ans = 1, base2 = (base % modulus).getMagnitude();
-    BigUnsigned::Index i = exponent.bitLength();
-    // For each bit of the exponent, most to least significant...
-    while (i > 0) {
+    if (modulus.isZero())
+        throw DivideByZeroError{ "BigInteger modexp" };
+    if (modulus == 1)
+        return 0;
+    BigUnsigned base2 = (base % modulus).getMagnitude();
+    if (modulus.getLength() >= specialModulusThreshold) {
+        if (std::optional<SpecialModulus> special = SpecialModulus::tryMake(modulus)) {
+            SpecialArithmetic arith(*special);
+            return strausMultiExp(arith, { base2 }, { exponent });
+        }
+    }
+    if (modulus.getBit(0))
+        return MontgomeryContext(modulus).exp(base2, exponent);
+
+    BigUnsigned::Index k = modulus.trailingZeros();
+    BigUnsigned m = modulus >> int(k);
+    BigUnsigned x1 = (m == 1) ? BigUnsigned(0) : MontgomeryContext(m).exp(base2, exponent);
+    BigUnsigned x2 = powerModPowerOfTwo(base2, exponent, k);
+    return combinePowerOfTwo(x1, m, x2, k);
+}
+
+BigUnsigned modmul(const BigUnsigned& a, const BigUnsigned& b, const BigUnsigned& modulus)
+{
+    if (modulus.isZero())
+        throw DivideByZeroError{ "BigInteger modmul" };
+    if (std::optional<SpecialModulus> special = SpecialModulus::tryMake(modulus))
+        return special->multiply(a, b);
+    return a * b % modulus;
+}
+
+/*
+ * The ladder keeps x0 = base^j and x1 = base^(j + 1) for the exponent prefix
+ * j read so far.  A 0 bit maps (x0, x1) to (x0^2, x0 x1) and a 1 bit to
+ * (x0 x1, x1^2); swapping x0 and x1 before and after the step turns the
+ * second case into the first, so every bit does the same two
+ * multiplications on the same kind of operands.
+ */
+BigUnsigned modexpConstantTime(const BigUnsigned& base, const BigUnsigned& exponent, const BigUnsigned& modulus)
+{
+    MontgomeryContext context(modulus);
+    Index k = context.getLength();
+    Index eLen = std::max(exponent.getLength(), k);
+    std::vector<Blk> e(eLen), x0(k), x1(k), t(2 * k);
+    for (Index i = 0; i < eLen; i++)
+        e[i] = exponent.getBlock(i);
+    context.load(x0.data(), 1);
+    context.load(x1.data(), base);
+    for (Index i = eLen * BigUnsigned::N; i > 0; i--) {
+        Blk mask = Blk(0) - ((e[(i - 1) / BigUnsigned::N] >> ((i - 1) % BigUnsigned::N)) & 1);
+        detail::conditionalSwap(x0.data(), x1.data(), k, mask);
+        context.multiplyBlocks(x1.data(), x0.data(), x1.data(), t.data());
+        context.multiplyBlocks(x0.data(), x0.data(), x0.data(), t.data());
+        detail::conditionalSwap(x0.data(), x1.data(), k, mask);
+    }
+    return context.store(x0.data());
+}
+
+/*
+ * Bases and exponents are handled exactly like in modexp: odd moduli use
+ * Montgomery arithmetic, and even ones are split into an odd part and a
+ * power of two.
+ */
+BigUnsigned multiExp(const std::vector<BigInteger>& bases,
+                     const std::vector<BigUnsigned>& exponents,
+                     const BigUnsigned& modulus)
+{
+    if (bases.size() != exponents.size())
+        throw MathError{ "BigInteger multiExp", "Bases and exponents differ in number" };
+    if (modulus.isZero())
+        throw DivideByZeroError{ "BigInteger multiExp" };
+    if (modulus == 1)
+        return 0;
+    std::vector<BigUnsigned> reduced;
+    for (const BigInteger& base : bases)
+        reduced.push_back((base % modulus).getMagnitude());
+    if (modulus.getBit(0)) {
+        MontgomeryArithmetic arith(modulus);
+        return multiExpWith(arith, reduced, exponents);
+    }
+
+    Index k = modulus.trailingZeros();
+    BigUnsigned m = modulus >> int(k), x1;
+    if (m != 1) {
+        MontgomeryArithmetic arith(m);
+        x1 = multiExpWith(arith, reduced, exponents);
+    }
+    TruncatedArithmetic arith(k);
+    return combinePowerOfTwo(x1, m, multiExpWith(arith, reduced, exponents), k);
+}
+
+BigUnsigned sqrtRem(const BigUnsigned& n, BigUnsigned& r)
+{
+    if (n.isZero()) {
+        r = 0;
+        return 0;
+    }
+    return sqrtRemNormalized(n, (n.bitLength() + 1) / 2, r);
+}
+
+BigUnsigned isqrt(const BigUnsigned& n)
+{
+    BigUnsigned r;
+    return sqrtRem(n, r);
+}
+
+bool isPerfectSquare(const BigUnsigned& n)
+{
+    if (!mayBeSquare(n))
+        return false;
+    BigUnsigned r;
+    sqrtRem(n, r);
+    return r.isZero();
+}
+
+/*
+ * Binary exponentiation into two buffers of the final size, so the power is
+ * never reallocated: each squaring or multiplication by the base writes into
+ * the buffer not holding the current power, and the two swap roles.  The
+ * final size is known up front since x^e has at most e * x.bitLength() bits.
+ * Factors of 2 in the base are stripped first and come back as one shift at
+ * the end, which is all there is to do for a power of 2.
+ */
+BigUnsigned pow(const BigUnsigned& base, std::uint64_t exponent)
+{
+    if (exponent == 0)
+        return 1;
+    if (base.isZero())
+        return 0;
+    // Any power of 1 fits, however large the exponent.
+    if (base == 1)
+        return 1;
+    Index zeros = base.trailingZeros();
+    BigUnsigned odd = base >> int(zeros);
+    unsigned long long bitsPerFactor = (unsigned long long)odd.bitLength() + zeros;
+    // Shift amounts are ints.
+    if (exponent > (unsigned long long)INT_MAX / bitsPerFactor)
+        throw MathError{ "BigInteger pow", "Result too large" };
+    int shift = int(zeros * exponent);
+    if (odd == 1)
+        return BigUnsigned(1) << shift;
+
+    Index oddLength = odd.getLength();
+    std::vector<Blk> b(oddLength);
+    for (Index i = 0; i < oddLength; i++)
+        b[i] = odd.getBlock(i);
+    // + 2: the products are written before their leading zeros are trimmed.
+    Index capacity = Index((exponent * odd.bitLength() + BigUnsigned::N - 1) / BigUnsigned::N) + 2;
+    std::vector<Blk> x(capacity), y(capacity);
+    std::copy(b.begin(), b.end(), x.begin());
+    Index length = oddLength;
+    int i = 63;
+    while (((exponent >> i) & 1) == 0)
         i--;
-        // Square.
-        ans *= ans;
-        ans %= modulus;
-        // And multiply if the bit is a 1.
-        if (exponent.getBit(i)) {
-            ans *= base2;
-            ans %= modulus;
+    for (i--; i >= 0; i--) {
+        detail::squareBlocks(y.data(), x.data(), length);
+        length *= 2;
+        while (y[length - 1] == 0)
+            length--;
+        x.swap(y);
+        if ((exponent >> i) & 1) {
+            detail::multiplyBlocks(y.data(), x.data(), length, b.data(), oddLength);
+            length += oddLength;
+            while (y[length - 1] == 0)
+                length--;
+            x.swap(y);
         }
     }
-    return ans;
+    return BigUnsigned(x.data(), length) << shift;
+}
+
+BigInteger pow(const BigInteger& base, std::uint64_t exponent)
+{
+    BigInteger::Sign sign = (base.getSign() == BigInteger::negative && (exponent & 1)) ? BigInteger::negative
+                                                                                      : BigInteger::positive;
+    return BigInteger(pow(base.getMagnitude(), exponent), sign);
+}
+
+BigUnsigned iroot(const BigUnsigned& n, Index k)
+{
+    if (k == 0)
+        throw MathError{ "BigInteger iroot", "Zeroth root" };
+    if (k == 1 || n.isZero())
+        return n;
+    if (k == 2)
+        return isqrt(n);
+    // n < 2^k means the root is 1.
+    if (n.bitLength() <= k)
+        return 1;
+    /* Newton's method for x^k = n, in integers.  A step from any x > 0 lands
+     * on or above the root (by the AM-GM inequality), and from above the
+     * root the steps decrease until they reach it.  Long roots are seeded
+     * with the root of the top half of n, scaled up, which is already right
+     * in its top half; since each step doubles the number of correct bits,
+     * the steps at full length are then only two or three. */
+    Index rootBits = (n.bitLength() + k - 1) / k;
+    BigUnsigned x, y;
+    if (rootBits <= rootSeedThreshold)
+        x = rootEstimate(n, k);
+    else {
+        Index h = rootBits / 2;
+        x = (iroot(n >> int(k * h), k) + 1) << int(h);
+    }
+    for (bool first = true;; first = false) {
+        y = (x * Blk(k - 1) + n / pow(x, k - 1)) / Blk(k);
+        if (!first && y >= x)
+            return x;
+        x = y;
+    }
+}
+
+bool isPerfectPower(const BigUnsigned& n, BigUnsigned& base, Index& exponent)
+{
+    base = n;
+    exponent = 1;
+    if (n <= 1) {
+        exponent = 2;
+        return true;
+    }
+    /* Take prime roots for as long as there are any: n = x^(p q ...) comes
+     * apart one prime at a time.  A power of 2 is x^p only for p dividing
+     * its exponent, and likewise for the power of 2 in n. */
+    BigUnsigned x = n, root;
+    std::vector<Index> primes = primesUpTo(n.bitLength());
+    for (std::size_t i = 0; i < primes.size() && primes[i] <= x.bitLength();) {
+        Index p = primes[i];
+        Index zeros = x.trailingZeros();
+        if ((zeros == 0 || zeros % p == 0) && isPrimePower(x, p, root)) {
+            x = root;
+            exponent *= p;
+            continue;
+        }
+        i++;
+    }
+    base = x;
+    return exponent > 1;
+}
+
+BigUnsigned productOf(const BigUnsigned* factors, std::size_t count)
+{
+    FactorPacker packer;
+    std::vector<BigUnsigned> large(1);
+    for (std::size_t i = 0; i < count; i++) {
+        if (factors[i].isZero())
+            return 0;
+        if (factors[i].getLength() == 1)
+            packer.add(factors[i].getBlock(0));
+        else
+            large.push_back(factors[i]);
+    }
+    large[0] = packer.product();
+    return treeProduct(large.data(), large.size());
+}
+
+BigUnsigned factorial(Index n)
+{
+    checkFactorialSize("BigInteger factorial", n);
+    // The power of 2 in n! is n minus the number of ones in n.
+    return oddFactorial(n, primesUpTo(n)) << int(n - detail::popCount(n));
+}
+
+/*
+ * For even n = 2m, n!! = 2^m m!.  For odd n = 2m + 1, n!! = n! / (2^m m!),
+ * so the exponent of each odd prime is its exponent in n! less that in m!.
+ */
+BigUnsigned doubleFactorial(Index n)
+{
+    Index m = n / 2;
+    if (n % 2 == 0)
+        return factorial(m) << int(m);
+    checkFactorialSize("BigInteger doubleFactorial", m);
+    std::vector<Index> primes = primesUpTo(n), exponents(primes.size());
+    for (std::size_t i = 1; i < primes.size(); i++)
+        exponents[i] = factorialExponent(n, primes[i]) - factorialExponent(m, primes[i]);
+    return primePowerProduct(primes, exponents);
+}
+
+/*
+ * When k is not tiny next to n, the exponent of each prime up to n is read
+ * off Legendre's formula for n!, k! and (n - k)!, which costs a sieve up to
+ * n and leaves no division.  Otherwise sieving up to n would cost more than
+ * the product itself, and the k factors of n (n - 1) ... (n - k + 1) are
+ * multiplied out and divided exactly by k!.
+ */
+BigUnsigned binomial(Index n, Index k)
+{
+    if (k > n)
+        return 0;
+    k = std::min(k, n - k);
+    if (k <= n / 16) {
+        FactorPacker packer;
+        for (Index i = 0; i < k; i++)
+            packer.add(n - i);
+        BigUnsigned r;
+        r.divideExact(packer.product(), factorial(k));
+        return r;
+    }
+    std::vector<Index> primes = primesUpTo(n), exponents(primes.size());
+    for (std::size_t i = 0; i < primes.size(); i++) {
+        Index p = primes[i];
+        exponents[i] = factorialExponent(n, p) - factorialExponent(k, p) - factorialExponent(n - k, p);
+    }
+    return primePowerProduct(primes, exponents);
+}
+
+BigUnsigned primorial(Index n)
+{
+    FactorPacker packer;
+    for (Index p : primesUpTo(n))
+        packer.add(p);
+    return packer.product();
+}
+
+bool isProbablePrime(const BigUnsigned& n, unsigned int rounds)
+{
+    int known = trialDivision(n);
+    if (known >= 0)
+        return known == 1;
+    MillerRabin test(n);
+    if (!test.isStrongProbablePrime(2))
+        return false;
+    // Uniform bases in [2, n - 2].
+    thread_local std::mt19937_64 rng(std::random_device{}());
+    BigUnsigned range = n - 3;
+    std::vector<Blk> blocks(n.getLength());
+    for (unsigned int i = 1; i < rounds; i++) {
+        for (Blk& b : blocks)
+            b = rng();
+        BigUnsigned a = BigUnsigned(blocks.data(), Index(blocks.size())) % range + 2;
+        if (!test.isStrongProbablePrime(a))
+            return false;
+    }
+    return true;
+}
+
+bool isBPSWPrime(const BigUnsigned& n)
+{
+    int known = trialDivision(n);
+    if (known >= 0)
+        return known == 1;
+    return isBPSWProbablePrime(n);
+}
+
+BigUnsigned nextPrime(const BigUnsigned& n)
+{
+    if (n < 2)
+        return 2;
+    BigUnsigned c = n + (n.getBit(0) ? 2 : 1);
+    if (c.bitLength() > 32)
+        return sieveForPrime(c, false);
+    while (!isBPSWPrime(c))
+        c += 2;
+    return c;
+}
+
+BigUnsigned prevPrime(const BigUnsigned& n)
+{
+    if (n <= 2)
+        throw MathError{ "BigInteger prevPrime", "No prime below n" };
+    if (n == 3)
+        return 2;
+    BigUnsigned c = n - (n.getBit(0) ? 2 : 1);
+    if (c.bitLength() > 32)
+        return sieveForPrime(c, true);
+    while (!isBPSWPrime(c))
+        c -= 2;
+    return c;
 }
-} // namespace fbi
\ No newline at end of file
+} // namespace fbi
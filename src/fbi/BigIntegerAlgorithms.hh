@@ -1,22 +1,189 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
 #include "BigInteger.hh"
 
 namespace fbi {
 /* Some mathematical algorithms for big integers.
  * This code is new and, as such, experimental. */
 
-// Returns the greatest common divisor of a and b.
+/* Returns the greatest common divisor of a and b.
+ * Long operands are first reduced with the recursive half-gcd algorithm. */
 BigUnsigned gcd(BigUnsigned a, BigUnsigned b);
 
 /* Extended Euclidean algorithm.
- * Given m and n, finds gcd g and numbers r, s such that r*m + s*n == g. */
-void extendedEuclidean(BigInteger m, BigInteger n, BigInteger& g, BigInteger& r, BigInteger& s);
+ * Given m and n, finds gcd g and numbers r, s such that r*m + s*n == g.
+ * g is always nonnegative.  Uses Lehmer's method: quotients are simulated on
+ * the leading bits with single-block cofactors, which are then applied to the
+ * full numbers in batches.  Operands of a few dozen blocks or more are first
+ * reduced with the subquadratic half-gcd algorithm.  Either way r and s are
+ * the cofactors of the classic Euclidean algorithm. */
+void extendedEuclidean(const BigInteger& m, const BigInteger& n, BigInteger& g, BigInteger& r, BigInteger& s);
+
+/* Same, but computes only the cofactor r of m, which is all that a modular
+ * inverse needs.  Saves the work of updating the cofactor of n. */
+void extendedEuclidean(const BigInteger& m, const BigInteger& n, BigInteger& g, BigInteger& r);
 
 /* Returns the multiplicative inverse of x modulo n, or throws an exception if
  * they have a common factor. */
 BigUnsigned modinv(const BigInteger& x, const BigUnsigned& n);
 
-// Returns (base ^ exponent) % modulus.
+/* Batch modular inversion (Montgomery's trick).
+ * Returns the inverses of xs[0], ..., xs[count - 1] modulo n at the cost of a
+ * single modinv and 3 (count - 1) modular multiplications.  invertible[i]
+ * tells whether xs[i] has an inverse at all; if it doesn't (xs[i] has a
+ * common factor with n), the returned element is 0 and the rest of the batch
+ * is unaffected. */
+std::vector<BigUnsigned> batchModinv(const BigUnsigned* xs,
+                                     std::size_t count,
+                                     const BigUnsigned& n,
+                                     std::vector<bool>& invertible);
+
+/* Returns (a * b) % modulus.  Moduli of the form 2^k - c or 2^k + c with a
+ * small c (see SpecialModulus) are reduced by folding instead of division.
+ * Callers that reuse such a modulus should build a SpecialModulus once and
+ * call its multiply instead.  Throws a DivideByZeroError if the modulus is
+ * 0. */
+BigUnsigned modmul(const BigUnsigned& a, const BigUnsigned& b, const BigUnsigned& modulus);
+
+/* Returns (base ^ exponent) % modulus.  Throws a DivideByZeroError if the
+ * modulus is 0. */
 BigUnsigned modexp(const BigInteger& base, const BigUnsigned& exponent, const BigUnsigned& modulus);
+
+/* Returns (base ^ exponent) % modulus in time independent of the values of
+ * base and exponent, for use with secret exponents.  Runs a Montgomery
+ * ladder with branch-free conditional swaps and Montgomery reductions over
+ * max(exponent.getLength(), modulus.getLength()) blocks of exponent bits, so
+ * only those block counts are revealed.  The base should be less than the
+ * modulus; a larger one is first reduced by an ordinary, variable-time
+ * division.  Throws a MathError if the modulus is even or zero. */
+BigUnsigned modexpConstantTime(const BigUnsigned& base, const BigUnsigned& exponent, const BigUnsigned& modulus);
+
+/* Returns the product of bases[i] ^ exponents[i], modulo modulus.  All the
+ * powers share one chain of squarings: bases are combined with interleaved
+ * sliding windows (Straus), or with Pippenger's bucket method when there
+ * are many of them.  Throws a MathError if the vectors differ in size and a
+ * DivideByZeroError if the modulus is 0. */
+BigUnsigned multiExp(const std::vector<BigInteger>& bases,
+                     const std::vector<BigUnsigned>& exponents,
+                     const BigUnsigned& modulus);
+
+/* Returns s = floor(sqrt(n)) and stores the remainder n - s^2 in r, which
+ * may be the same object as n.  Uses Zimmermann's Karatsuba square root,
+ * which costs about as much as a few multiplications and divisions of n. */
+BigUnsigned sqrtRem(const BigUnsigned& n, BigUnsigned& r);
+
+// Returns floor(sqrt(n)).
+BigUnsigned isqrt(const BigUnsigned& n);
+
+/* Returns whether n is the square of an integer.  Most non-squares are
+ * rejected by their residues modulo 64, 63, 65 and 11 without taking the
+ * root. */
+bool isPerfectSquare(const BigUnsigned& n);
+
+/* Returns base ^ exponent, with 0 ^ 0 == 1.  The work buffers are allocated
+ * once at their final size, squarings go to the squaring kernels, and factors
+ * of 2 in the base cost only a shift.  Throws a MathError if the result would
+ * have more than INT_MAX bits; a base of magnitude 1 never does. */
+BigUnsigned pow(const BigUnsigned& base, std::uint64_t exponent);
+BigInteger pow(const BigInteger& base, std::uint64_t exponent);
+
+/* Returns floor(n^(1/k)) by Newton's method, seeded with a root of the
+ * leading bits of n.  Throws a MathError if k is 0. */
+BigUnsigned iroot(const BigUnsigned& n, BigUnsigned::Index k);
+
+/* Returns whether n is x^e for some e >= 2, and if so stores the smallest
+ * such x in base and the matching e in exponent; otherwise stores n and 1.
+ * 0 and 1 count as perfect powers, with exponent 2.  Only prime exponents up
+ * to n.bitLength() are tried, and most of those are ruled out by the power
+ * of 2 in n or by its residues modulo small primes before any root is
+ * taken. */
+bool isPerfectPower(const BigUnsigned& n, BigUnsigned& base, BigUnsigned::Index& exponent);
+
+/* PRODUCTS
+ * These multiply their factors in balanced product trees, with small factors
+ * first multiplied together into single blocks, so the large multiplications
+ * are between numbers of similar length. */
+
+// Returns the product of factors[0], ..., factors[count - 1], or 1 if count is 0.
+BigUnsigned productOf(const BigUnsigned* factors, std::size_t count);
+
+/* Same, for the factors in [first, last), which may be of any type that
+ * converts to BigUnsigned. */
+template <class InputIterator>
+BigUnsigned productOf(InputIterator first, InputIterator last)
+{
+    std::vector<BigUnsigned> factors(first, last);
+    return productOf(factors.data(), factors.size());
+}
+
+/* Returns n!, by the prime-swing algorithm: n! = floor(n/2)!^2 times a
+ * product of prime powers, with the factors of 2 applied as one shift.
+ * Throws a MathError if the result would have more than INT_MAX bits. */
+BigUnsigned factorial(BigUnsigned::Index n);
+
+/* Returns n!! = n (n - 2) (n - 4) ..., with 0!! == 1.  Throws a MathError
+ * if factorial(n / 2) would. */
+BigUnsigned doubleFactorial(BigUnsigned::Index n);
+
+/* Returns the binomial coefficient C(n, k), which is 0 for k > n.  Unless k
+ * or n - k is small, the result is built from its prime factorization. */
+BigUnsigned binomial(BigUnsigned::Index n, BigUnsigned::Index k);
+
+// Returns the product of the primes up to n.
+BigUnsigned primorial(BigUnsigned::Index n);
+
+/* PRIMALITY
+ * Both tests first divide n by the odd primes below 1024, computing its
+ * residues modulo products of those primes in a single pass over its blocks.
+ * Below 2^64 they then run Miller-Rabin with a base set known to be correct
+ * there, so the answer is exact. */
+
+/* Returns whether n is probably prime, by Miller-Rabin with base 2 and then
+ * rounds - 1 random bases, which share one Montgomery context.  Primes
+ * always pass; a composite passes each random round with probability at
+ * most 1/4. */
+bool isProbablePrime(const BigUnsigned& n, unsigned int rounds);
+
+/* Returns whether n is prime by the Baillie-PSW test: a strong probable
+ * prime test to base 2 and a strong Lucas test with Selfridge's parameters.
+ * No composite is known to pass both. */
+bool isBPSWPrime(const BigUnsigned& n);
+
+/* Return the least prime above n and the greatest prime below n, by the
+ * Baillie-PSW test.  For n of more than 32 bits, runs of candidates are
+ * first sieved by small primes, so only the survivors are tested.
+ * prevPrime throws a MathError if n <= 2. */
+BigUnsigned nextPrime(const BigUnsigned& n);
+BigUnsigned prevPrime(const BigUnsigned& n);
+
+/* Returns a random prime of exactly `bits' bits: the first prime at or
+ * above a random number of that length, drawn again if there is none.
+ * Primes that follow long gaps are a little more likely than others.  The
+ * generator is any uniform random bit generator, such as std::mt19937_64 or
+ * std::random_device.  Throws a MathError if bits < 2. */
+template <class Generator>
+BigUnsigned randomPrime(BigUnsigned::Index bits, Generator& generator)
+{
+    typedef BigUnsigned::Blk Blk;
+    if (bits < 2)
+        throw MathError{ "BigInteger randomPrime", "Too few bits" };
+    std::uniform_int_distribution<Blk> block;
+    std::vector<Blk> b((bits + BigUnsigned::N - 1) / BigUnsigned::N);
+    unsigned int topBits = (bits - 1) % BigUnsigned::N + 1;
+    for (;;) {
+        for (Blk& x : b)
+            x = block(generator);
+        if (topBits < BigUnsigned::N)
+            b.back() &= (Blk(1) << topBits) - 1;
+        b.back() |= Blk(1) << (topBits - 1);
+        BigUnsigned p = nextPrime(BigUnsigned(b.data(), BigUnsigned::Index(b.size())) - 1);
+        if (p.bitLength() == bits)
+            return p;
+    }
+}
 } // namespace fbi
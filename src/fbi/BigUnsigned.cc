@@ -1,6 +1,13 @@
 #include "BigUnsigned.hh"
 
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
 #include "BigIntegerUtils.hh"
+#include "BlockArithmetic.hh"
+#include "Kernels.hh"
 
 // Memory management definitions have moved to the bottom of NumberlikeArray.hh.
 
@@ -8,7 +15,7 @@
 // BigUnsigned.hh.
 
 namespace fbi {
-BigUnsigned::BigUnsigned(int, Index c) : NumberlikeArray<Blk>(0, c) {}
+BigUnsigned::BigUnsigned(int, Index c) : NumberlikeArray<Blk>(c) {}
 
 void BigUnsigned::zapLeadingZeros()
 {
@@ -16,6 +23,14 @@ void BigUnsigned::zapLeadingZeros()
         len--;
 }
 
+void BigUnsigned::allocateKeeping(Index c, bool keep)
+{
+    if (keep)
+        allocateAndCopy(c);
+    else
+        allocate(c);
+}
+
 BigUnsigned::BigUnsigned() : NumberlikeArray<Blk>() {}
 
 BigUnsigned::BigUnsigned(const BigUnsigned& x) : NumberlikeArray<Blk>(x) {}
@@ -181,15 +196,7 @@ BigUnsigned::Index BigUnsigned::bitLength() const
 {
     if (isZero())
         return 0;
-    else {
-        Blk leftmostBlock = getBlock(len - 1);
-        Index leftmostBlockLen = 0;
-        while (leftmostBlock != 0) {
-            leftmostBlock >>= 1;
-            leftmostBlockLen++;
-        }
-        return leftmostBlockLen + (len - 1) * N;
-    }
+    return len * N - detail::leadingZeros(blk[len - 1]);
 }
 
 bool BigUnsigned::getBit(Index bi) const
@@ -205,6 +212,60 @@ void BigUnsigned::setBit(Index bi, bool newBit)
     setBlock(blockI, block);
 }
 
+/* The bit counts and scans work a block at a time.  popCount and
+ * hammingDistance run through the blockwise kernels, which count several
+ * blocks per instruction on large numbers. */
+BigUnsigned::Index BigUnsigned::popCount() const
+{
+    return detail::bitwiseKernels().popCount(blk, len);
+}
+
+BigUnsigned::Index BigUnsigned::trailingZeros() const
+{
+    Index i = nextSetBit(0);
+    return (i == npos) ? 0 : i;
+}
+
+BigUnsigned::Index BigUnsigned::nextSetBit(Index bi) const
+{
+    Index i = bi / N;
+    if (i >= len)
+        return npos;
+    // Clear the bits of the first block below bi.
+    Blk b = blk[i] & (~Blk(0) << (bi % N));
+    while (b == 0) {
+        if (++i == len)
+            return npos;
+        b = blk[i];
+    }
+    return i * N + detail::trailingZeros(b);
+}
+
+BigUnsigned::Index BigUnsigned::nextClearBit(Index bi) const
+{
+    Index i = bi / N;
+    if (i >= len)
+        return bi;
+    // Look for a zero among the bits of the first block from bi up.
+    Blk b = ~blk[i] & (~Blk(0) << (bi % N));
+    while (b == 0) {
+        if (++i == len)
+            return len * N;
+        b = ~blk[i];
+    }
+    return i * N + detail::trailingZeros(b);
+}
+
+BigUnsigned::Index BigUnsigned::hammingDistance(const BigUnsigned& x) const
+{
+    const BigUnsigned *a = this, *b = &x;
+    if (a->len < b->len)
+        std::swap(a, b);
+    // Past the end of the shorter number, every set bit of the longer one differs.
+    const detail::BitwiseKernels& kernels = detail::bitwiseKernels();
+    return kernels.hammingDistance(a->blk, b->blk, b->len) + kernels.popCount(a->blk + b->len, a->len - b->len);
+}
+
 // COMPARISON
 BigUnsigned::CmpRes BigUnsigned::compareTo(const BigUnsigned& x) const
 {
@@ -214,30 +275,35 @@ BigUnsigned::CmpRes BigUnsigned::compareTo(const BigUnsigned& x) const
     else if (len > x.len)
         return greater;
     else {
-        // Compare blocks one by one from left to right.
-        Index i = len;
-        while (i > 0) {
-            i--;
-            if (blk[i] == x.blk[i])
-                continue;
-            else if (blk[i] > x.blk[i])
-                return greater;
-            else
-                return less;
-        }
-        // If no blocks differed, the numbers are equal.
-        return equal;
+        // The most significant block that differs decides.
+        Index i = detail::bitwiseKernels().highestDifference(blk, x.blk, len);
+        if (i == 0)
+            return equal;
+        return (blk[i - 1] > x.blk[i - 1]) ? greater : less;
     }
 }
 
+BigUnsigned::CmpRes BigUnsigned::compareToSmall(Blk x) const
+{
+    if (len > 1)
+        return greater;
+    Blk b = (len == 0) ? 0 : blk[0];
+    if (b < x)
+        return less;
+    else if (b > x)
+        return greater;
+    else
+        return equal;
+}
+
 bool BigUnsigned::operator==(const BigUnsigned& x) const
 {
-    return NumberlikeArray<Blk>::operator==(x);
+    return len == x.len && detail::bitwiseKernels().highestDifference(blk, x.blk, len) == 0;
 }
 
 bool BigUnsigned::operator!=(const BigUnsigned& x) const
 {
-    return NumberlikeArray<Blk>::operator!=(x);
+    return !operator==(x);
 }
 
 bool BigUnsigned::operator<(const BigUnsigned& x) const
@@ -269,18 +335,20 @@ bool BigUnsigned::operator>(const BigUnsigned& x) const
  * stored (an "aliased" call), we risk overwriting the input before we read it.
  * In this case, we first compute the result into a temporary BigUnsigned
  * variable and then copy it into the requested output variable *this.
- * Each put-here operation uses the DTRT_ALIASED macro (Do The Right Thing on
- * aliased calls) to generate code for this check.
+ * Put-here operations that need this use the DTRT_ALIASED macro (Do The
+ * Right Thing on aliased calls) to generate code for the check.
  *
  * I adopted this approach on 2007.02.13 (see Assignment Operators in
  * BigUnsigned.hh).  Before then, put-here operations rejected aliased calls
  * with an exception.  I think doing the right thing is better.
  *
- * Some of the put-here operations can probably handle aliased calls safely
- * without the extra copy because (for example) they process blocks strictly
- * right-to-left.  At some point I might determine which ones don't need the
- * copy, but my reasoning would need to be verified very carefully.  For now
- * I'll leave in the copy.
+ * Addition, subtraction, the bitwise operations and the shifts don't need
+ * the copy: each block of the result depends only on input blocks at the
+ * same index or on the side that hasn't been written yet, so they run in
+ * place.  They work from the least significant block up, except for the
+ * left shift, which works from the top down.  When *this is an operand
+ * they grow the array with `allocateKeeping' so its blocks survive, and they
+ * copy all operand lengths into locals before they change `len'.
  */
 #define DTRT_ALIASED(cond, op) \
     if (cond) {                \
@@ -292,7 +360,6 @@ bool BigUnsigned::operator>(const BigUnsigned& x) const
 
 void BigUnsigned::add(const BigUnsigned& a, const BigUnsigned& b)
 {
-    DTRT_ALIASED(this == &a || this == &b, add(a, b));
     // If one argument is zero, copy the other.
     if (a.len == 0) {
         operator=(b);
@@ -302,11 +369,6 @@ void BigUnsigned::add(const BigUnsigned& a, const BigUnsigned& b)
         operator=(a);
         return;
     }
-    // Some variables...
-    // Carries in and out of an addition stage
-    bool carryIn, carryOut;
-    Blk temp;
-    Index i;
     // a2 points to the longer input, b2 points to the shorter
     const BigUnsigned *a2, *b2;
     if (a.len >= b.len) {
@@ -317,45 +379,30 @@ void BigUnsigned::add(const BigUnsigned& a, const BigUnsigned& b)
         a2 = &b;
         b2 = &a;
     }
-    // Set prelimiary length and make room in this BigUnsigned
-    len = a2->len + 1;
-    allocate(len);
-    // For each block index that is present in both inputs...
-    for (i = 0, carryIn = false; i < b2->len; i++) {
-        // Add input blocks
-        temp = a2->blk[i] + b2->blk[i];
-        // If a rollover occurred, the result is less than either input.
-        // This test is used many times in the BigUnsigned code.
-        carryOut = (temp < a2->blk[i]);
-        // If a carry was input, handle it
-        if (carryIn) {
-            temp++;
-            carryOut |= (temp == 0);
-        }
-        blk[i] = temp; // Save the addition result
-        carryIn = carryOut; // Pass the carry along
-    }
+    Index aLen = a2->len, bLen = b2->len, i;
+    // Make room in this BigUnsigned, with a block for the final carry
+    allocateKeeping(aLen + 1, this == &a || this == &b);
+    // Add the blocks that are present in both inputs.
+    Blk carry = detail::addBlocks(blk, a2->blk, b2->blk, bLen);
     // If there is a carry left over, increase blocks until
     // one does not roll over.
-    for (; i < a2->len && carryIn; i++) {
-        temp = a2->blk[i] + 1;
-        carryIn = (temp == 0);
-        blk[i] = temp;
+    for (i = bLen; i < aLen && carry != 0; i++) {
+        blk[i] = a2->blk[i] + 1;
+        carry = (blk[i] == 0);
     }
     // If the carry was resolved but the larger number
-    // still has blocks, copy them over.
-    for (; i < a2->len; i++)
-        blk[i] = a2->blk[i];
-    // Set the extra block if there's still a carry, decrease length otherwise
-    if (carryIn)
-        blk[i] = 1;
-    else
-        len--;
+    // still has blocks, copy them over (unless they are already here).
+    if (a2 != this)
+        for (; i < aLen; i++)
+            blk[i] = a2->blk[i];
+    // Set the extra block if there's still a carry
+    len = aLen;
+    if (carry != 0)
+        blk[len++] = 1;
 }
 
 void BigUnsigned::subtract(const BigUnsigned& a, const BigUnsigned& b)
 {
-    DTRT_ALIASED(this == &a || this == &b, subtract(a, b));
     if (b.len == 0) {
         // If b is zero, copy a.
         operator=(a);
@@ -364,54 +411,38 @@ void BigUnsigned::subtract(const BigUnsigned& a, const BigUnsigned& b)
     else if (a.len < b.len)
         // If a is shorter than b, the result is negative.
         throw SignError{ "BigUnsigned::subtract", "Negative result in unsigned calculation" };
-    // Some variables...
-    bool borrowIn, borrowOut;
-    Blk temp;
-    Index i;
-    // Set preliminary length and make room
-    len = a.len;
-    allocate(len);
-    // For each block index that is present in both inputs...
-    for (i = 0, borrowIn = false; i < b.len; i++) {
-        temp = a.blk[i] - b.blk[i];
-        // If a reverse rollover occurred,
-        // the result is greater than the block from a.
-        borrowOut = (temp > a.blk[i]);
-        // Handle an incoming borrow
-        if (borrowIn) {
-            borrowOut |= (temp == 0);
-            temp--;
-        }
-        blk[i] = temp; // Save the subtraction result
-        borrowIn = borrowOut; // Pass the borrow along
-    }
+    Index aLen = a.len, bLen = b.len, i;
+    // Make room
+    allocateKeeping(aLen, this == &a || this == &b);
+    // Subtract the blocks that are present in both inputs.
+    Blk borrow = detail::subtractBlocks(blk, a.blk, b.blk, bLen);
     // If there is a borrow left over, decrease blocks until
     // one does not reverse rollover.
-    for (; i < a.len && borrowIn; i++) {
-        borrowIn = (a.blk[i] == 0);
+    for (i = bLen; i < aLen && borrow != 0; i++) {
+        borrow = (a.blk[i] == 0);
         blk[i] = a.blk[i] - 1;
     }
     /* If there's still a borrow, the result is negative.
      * Throw an exception, but zero out this object so as to leave it in a
      * predictable state. */
-    if (borrowIn) {
+    if (borrow != 0) {
         len = 0;
         throw SignError{ "BigUnsigned::subtract", "Negative result in unsigned calculation" };
     }
-    else
+    else if (&a != this)
         // Copy over the rest of the blocks
-        for (; i < a.len; i++)
+        for (; i < aLen; i++)
             blk[i] = a.blk[i];
     // Zap leading zeros
+    len = aLen;
     zapLeadingZeros();
 }
 
 /*
  * About the multiplication and division algorithms:
  *
- * I searched unsucessfully for fast C++ built-in operations like the `b_0'
- * and `c_0' Knuth describes in Section 4.3.1 of ``The Art of Computer
- * Programming'' (replace `place' by `Blk'):
+ * Knuth describes these built-in operations in Section 4.3.1 of ``The Art of
+ * Computer Programming'' (replace `place' by `Blk'):
  *
  *    ``b_0[:] multiplication of a one-place integer by another one-place
  *      integer, giving a two-place answer;
@@ -420,55 +451,204 @@ void BigUnsigned::subtract(const BigUnsigned& a, const BigUnsigned& b)
  *      provided that the quotient is a one-place integer, and yielding
  *      also a one-place remainder.''
  *
- * I also missed his note that ``[b]y adjusting the word size, if
- * necessary, nearly all computers will have these three operations
- * available'', so I gave up on trying to use algorithms similar to his.
- * A future version of the library might include such algorithms; I
- * would welcome contributions from others for this.
- *
- * I eventually decided to use bit-shifting algorithms.  To multiply `a'
- * and `b', we zero out the result.  Then, for each `1' bit in `a', we
- * shift `b' left the appropriate amount and add it to the result.
- * Similarly, to divide `a' by `b', we shift `b' left varying amounts,
- * repeatedly trying to subtract it from `a'.  When we succeed, we note
- * the fact by setting a bit in the quotient.  While these algorithms
- * have the same O(n^2) time complexity as Knuth's, the ``constant factor''
- * is likely to be larger.
+ * Multiplication uses `b_0' (see `mulBlocks' in BlockArithmetic.hh) for
+ * Knuth's Algorithm M on small operands and Karatsuba's method on top of it
+ * for large ones.
  *
- * Because I used these algorithms, which require single-block addition
- * and subtraction rather than single-block multiplication and division,
- * the innermost loops of all four routines are very similar.  Study one
- * of them and all will become clear.
+ * Division is Knuth's Algorithm D on top of `c_0' (see `divBlocks'): each
+ * block of the quotient is estimated from the leading blocks of the
+ * remainder and the divisor, corrected at most twice, and then a multiple of
+ * the divisor is subtracted in one pass.
  */
 
-/*
- * This is a little inline function used by both the multiplication
- * routine and the division routine.
- *
- * `getShiftedBlock' returns the `x'th block of `num << y'.
- * `y' may be anything from 0 to N - 1, and `x' may be anything from
- * 0 to `num.len'.
- *
- * Two things contribute to this block:
- *
- * (1) The `N - y' low bits of `num.blk[x]', shifted `y' bits left.
- *
- * (2) The `y' high bits of `num.blk[x-1]', shifted `N - y' bits right.
- *
- * But we must be careful if `x == 0' or `x == num.len', in
- * which case we should use 0 instead of (2) or (1), respectively.
- *
- * If `y == 0', then (2) contributes 0, as it should.  However,
- * in some computer environments, for a reason I cannot understand,
- * `a >> b' means `a >> (b % N)'.  This means `num.blk[x-1] >> (N - y)'
- * will return `num.blk[x-1]' instead of the desired 0 when `y == 0';
- * the test `y == 0' handles this case specially.
- */
-inline BigUnsigned::Blk getShiftedBlock(const BigUnsigned& num, BigUnsigned::Index x, unsigned int y)
+namespace {
+typedef BigUnsigned::Blk Blk;
+typedef BigUnsigned::Index Index;
+
+/* Adds x[0..xn) into r[0..rn), propagating the carry through r.  The caller
+ * guarantees that the sum fits in rn blocks. */
+void addBlocksInto(Blk* r, Index rn, const Blk* x, Index xn)
+{
+    Blk carry = detail::addBlocks(r, r, x, xn);
+    for (Index i = xn; carry && i < rn; i++) {
+        r[i]++;
+        carry = (r[i] == 0);
+    }
+}
+
+/* Subtracts x[0..xn) from r[0..rn), propagating the borrow through r.  The
+ * caller guarantees that the difference is nonnegative. */
+void subtractBlocksFrom(Blk* r, Index rn, const Blk* x, Index xn)
 {
-    BigUnsigned::Blk part1 = (x == 0 || y == 0) ? 0 : (num.blk[x - 1] >> (BigUnsigned::N - y));
-    BigUnsigned::Blk part2 = (x == num.len) ? 0 : (num.blk[x] << y);
-    return part1 | part2;
+    Blk borrow = detail::subtractBlocks(r, r, x, xn);
+    for (Index i = xn; borrow && i < rn; i++) {
+        borrow = (r[i] == 0);
+        r[i]--;
+    }
+}
+
+// Returns the length of x[0..xn) without leading zero blocks.
+Index trimmedLength(const Blk* x, Index xn)
+{
+    while (xn > 0 && x[xn - 1] == 0)
+        xn--;
+    return xn;
+}
+
+/* r[0..n) -= x[0..n) * m; returns the block borrowed from above the top.  r
+ * may alias x. */
+Blk subMulRow(Blk* r, const Blk* x, Index n, Blk m)
+{
+    Blk borrow = 0;
+    for (Index i = 0; i < n; i++) {
+        Blk hi;
+        Blk lo = detail::mulBlocks(x[i], m, hi);
+        lo += borrow;
+        hi += (lo < borrow);
+        Blk t = r[i];
+        r[i] = t - lo;
+        borrow = hi + (t < lo);
+    }
+    return borrow;
+}
+
+} // namespace
+
+/* On x86-64 with GCC or Clang, the bulk of an addition or subtraction runs
+ * four blocks per iteration in assembly, keeping the carry in the carry flag
+ * from one iteration to the next: between the adc/sbb instructions there are
+ * only lea and dec, which leave the flag alone.  The compilers don't manage
+ * this from the intrinsics by themselves, and it brings the loop to about one
+ * block per cycle.  The remaining n % 4 blocks, and other targets, use
+ * addCarry and subBorrow. */
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define FBI_CARRY_CHAIN(insn)   \
+    "clc\n"                     \
+    "1:\n\t"                    \
+    "movq (%[x]), %[t0]\n\t"    \
+    "movq 8(%[x]), %[t1]\n\t"   \
+    "movq 16(%[x]), %[t2]\n\t"  \
+    "movq 24(%[x]), %[t3]\n\t"  \
+    insn " (%[y]), %[t0]\n\t"   \
+    insn " 8(%[y]), %[t1]\n\t"  \
+    insn " 16(%[y]), %[t2]\n\t" \
+    insn " 24(%[y]), %[t3]\n\t" \
+    "movq %[t0], (%[r])\n\t"    \
+    "movq %[t1], 8(%[r])\n\t"   \
+    "movq %[t2], 16(%[r])\n\t"  \
+    "movq %[t3], 24(%[r])\n\t"  \
+    "leaq 32(%[x]), %[x]\n\t"   \
+    "leaq 32(%[y]), %[y]\n\t"   \
+    "leaq 32(%[r]), %[r]\n\t"   \
+    "decq %[n]\n\t"             \
+    "jnz 1b\n\t"                \
+    "setc %b[c]"
+#define FBI_CARRY_CHAIN_OPERANDS                                                                            \
+    : [x] "+r"(xp), [y] "+r"(yp), [r] "+r"(rp), [n] "+r"(groups), [c] "+r"(c), [t0] "=&r"(t0), [t1] "=&r"(t1), \
+      [t2] "=&r"(t2), [t3] "=&r"(t3)                                                                          \
+    :                                                                                                         \
+    : "cc", "memory"
+#endif
+
+Blk detail::addBlocks(Blk* r, const Blk* x, const Blk* y, Index n)
+{
+    Blk c = 0;
+    Index i = 0;
+#ifdef FBI_CARRY_CHAIN
+    if (Blk groups = n / 4) {
+        const Blk *xp = x, *yp = y;
+        Blk *rp = r, t0, t1, t2, t3;
+        __asm__(FBI_CARRY_CHAIN("adcq") FBI_CARRY_CHAIN_OPERANDS);
+        i = n - n % 4;
+    }
+#endif
+    for (; i < n; i++)
+        r[i] = addCarry(x[i], y[i], c);
+    return c;
+}
+
+Blk detail::subtractBlocks(Blk* r, const Blk* x, const Blk* y, Index n)
+{
+    Blk c = 0;
+    Index i = 0;
+#ifdef FBI_CARRY_CHAIN
+    if (Blk groups = n / 4) {
+        const Blk *xp = x, *yp = y;
+        Blk *rp = r, t0, t1, t2, t3;
+        __asm__(FBI_CARRY_CHAIN("sbbq") FBI_CARRY_CHAIN_OPERANDS);
+        i = n - n % 4;
+    }
+#endif
+    for (; i < n; i++)
+        r[i] = subBorrow(x[i], y[i], c);
+    return c;
+}
+
+// Karatsuba's method for squares, with z1 = (a0 + a1)^2 - z0 - z2.
+void detail::squareBlocks(Blk* r, const Blk* a, Index n)
+{
+    const MultiplyKernels& kernels = multiplyKernels();
+    if (n < kernels.karatsubaThreshold) {
+        kernels.square(r, a, n);
+        return;
+    }
+    Index h = (n + 1) / 2, a1n = n - h;
+    squareBlocks(r, a, h);
+    squareBlocks(r + 2 * h, a + h, a1n);
+    std::vector<Blk> sa(a, a + h), z1(2 * h + 2);
+    sa.push_back(0);
+    addBlocksInto(sa.data(), h + 1, a + h, a1n);
+    squareBlocks(z1.data(), sa.data(), h + 1);
+    subtractBlocksFrom(z1.data(), 2 * h + 2, r, trimmedLength(r, 2 * h));
+    subtractBlocksFrom(z1.data(), 2 * h + 2, r + 2 * h, trimmedLength(r + 2 * h, 2 * a1n));
+    addBlocksInto(r + h, 2 * n - h, z1.data(), trimmedLength(z1.data(), 2 * h + 2));
+}
+
+/* Karatsuba's method splits both operands at h blocks:
+ *     a * b = z2 * B^(2h) + z1 * B^h + z0,
+ * where z0 = a0 * b0, z2 = a1 * b1 and z1 = (a0 + a1)(b0 + b1) - z0 - z2,
+ * trading one of the four half-size products for a few additions. */
+void detail::multiplyBlocks(Blk* r, const Blk* a, Index an, const Blk* b, Index bn)
+{
+    const MultiplyKernels& kernels = multiplyKernels();
+    if (bn < kernels.karatsubaThreshold) {
+        kernels.multiply(r, a, an, b, bn);
+        return;
+    }
+    Index h = (an + 1) / 2;
+    if (bn <= h) {
+        /* Very unbalanced operands: multiply b by bn-block slices of a and
+         * add the partial products. */
+        std::vector<Blk> part(2 * bn);
+        for (Index i = 0; i < an + bn; i++)
+            r[i] = 0;
+        for (Index i = 0; i < an; i += bn) {
+            Index sn = (an - i < bn) ? an - i : bn;
+            if (sn >= bn)
+                multiplyBlocks(part.data(), a + i, sn, b, bn);
+            else
+                multiplyBlocks(part.data(), b, bn, a + i, sn);
+            addBlocksInto(r + i, an + bn - i, part.data(), trimmedLength(part.data(), sn + bn));
+        }
+        return;
+    }
+    // Now h < bn <= an, so both high halves are nonempty.
+    Index a1n = an - h, b1n = bn - h;
+    // z0 and z2 go straight into their places in r.
+    multiplyBlocks(r, a, h, b, h);
+    multiplyBlocks(r + 2 * h, a + h, a1n, b + h, b1n);
+    // Sums of the halves, each with room for a carry.
+    std::vector<Blk> sa(h + 1, 0), sb(h + 1, 0), z1(2 * h + 2);
+    for (Index i = 0; i < h; i++) {
+        sa[i] = a[i];
+        sb[i] = b[i];
+    }
+    addBlocksInto(sa.data(), h + 1, a + h, a1n);
+    addBlocksInto(sb.data(), h + 1, b + h, b1n);
+    multiplyBlocks(z1.data(), sa.data(), h + 1, sb.data(), h + 1);
+    subtractBlocksFrom(z1.data(), 2 * h + 2, r, trimmedLength(r, 2 * h));
+    subtractBlocksFrom(z1.data(), 2 * h + 2, r + 2 * h, trimmedLength(r + 2 * h, a1n + b1n));
+    addBlocksInto(r + h, an + bn - h, z1.data(), trimmedLength(z1.data(), 2 * h + 2));
 }
 
 void BigUnsigned::multiply(const BigUnsigned& a, const BigUnsigned& b)
@@ -479,70 +659,269 @@ void BigUnsigned::multiply(const BigUnsigned& a, const BigUnsigned& b)
         len = 0;
         return;
     }
-    /*
-     * Overall method:
-     *
-     * Set this = 0.
-     * For each 1-bit of `a' (say the `i2'th bit of block `i'):
-     *    Add `b << (i blocks and i2 bits)' to *this.
-     */
-    // Variables for the calculation
-    Index i, j, k;
-    unsigned int i2;
-    Blk temp;
-    bool carryIn, carryOut;
     // Set preliminary length and make room
     len = a.len + b.len;
     allocate(len);
-    // Zero out this object
-    for (i = 0; i < len; i++)
+    if (&a == &b)
+        detail::squareBlocks(blk, a.blk, a.len);
+    else if (a.len >= b.len)
+        detail::multiplyBlocks(blk, a.blk, a.len, b.blk, b.len);
+    else
+        detail::multiplyBlocks(blk, b.blk, b.len, a.blk, a.len);
+    // Zap possible leading zero
+    if (blk[len - 1] == 0)
+        len--;
+}
+
+/*
+ * FUSED MULTIPLY-ADD
+ * `addMul' and `subMul' add or subtract the partial products of a * b
+ * straight into the blocks of *this, one row per block of the shorter
+ * operand, so no product temporary is built.  Long operands still go through
+ * Karatsuba's method into a temporary, since the rows would cost more than
+ * the allocation saves.  For aliased calls the product is formed first.
+ */
+void BigUnsigned::addMul(const BigUnsigned& a, const BigUnsigned& b)
+{
+    if (a.len == 0 || b.len == 0)
+        return;
+    if (this == &a || this == &b) {
+        BigUnsigned product;
+        product.multiply(a, b);
+        add(*this, product);
+        return;
+    }
+    // x points to the longer operand, y to the shorter
+    const BigUnsigned *x = &a, *y = &b;
+    if (a.len < b.len) {
+        x = &b;
+        y = &a;
+    }
+    Index pn = x->len + y->len;
+    Index n = ((len > pn) ? len : pn) + 1;
+    allocateAndCopy(n);
+    for (Index i = len; i < n; i++)
         blk[i] = 0;
-    // For each block of the first number...
-    for (i = 0; i < a.len; i++) {
-        // For each 1-bit of that block...
-        for (i2 = 0; i2 < N; i2++) {
-            if ((a.blk[i] & (Blk(1) << i2)) == 0)
-                continue;
-            /*
-             * Add b to this, shifted left i blocks and i2 bits.
-             * j is the index in b, and k = i + j is the index in this.
-             *
-             * `getShiftedBlock', a short inline function defined above,
-             * is now used for the bit handling.  It replaces the more
-             * complex `bHigh' code, in which each run of the loop dealt
-             * immediately with the low bits and saved the high bits to
-             * be picked up next time.  The last run of the loop used to
-             * leave leftover high bits, which were handled separately.
-             * Instead, this loop runs an additional time with j == b.len.
-             * These changes were made on 2005.01.11.
-             */
-            for (j = 0, k = i, carryIn = false; j <= b.len; j++, k++) {
-                /*
-                 * The body of this loop is very similar to the body of the first loop
-                 * in `add', except that this loop does a `+=' instead of a `+'.
-                 */
-                temp = blk[k] + getShiftedBlock(b, j, i2);
-                carryOut = (temp < blk[k]);
-                if (carryIn) {
-                    temp++;
-                    carryOut |= (temp == 0);
-                }
-                blk[k] = temp;
-                carryIn = carryOut;
-            }
-            // No more extra iteration to deal with `bHigh'.
-            // Roll-over a carry as necessary.
-            for (; carryIn; k++) {
-                blk[k]++;
-                carryIn = (blk[k] == 0);
+    if (y->len < detail::multiplyKernels().karatsubaThreshold) {
+        auto addMulRow = detail::multiplyKernels().addMulRow;
+        for (Index i = 0; i < y->len; i++) {
+            Blk carry = addMulRow(blk + i, x->blk, x->len, y->blk[i]);
+            addBlocksInto(blk + i + x->len, n - i - x->len, &carry, 1);
+        }
+    }
+    else {
+        std::vector<Blk> product(pn);
+        detail::multiplyBlocks(product.data(), x->blk, x->len, y->blk, y->len);
+        addBlocksInto(blk, n, product.data(), trimmedLength(product.data(), pn));
+    }
+    len = n;
+    zapLeadingZeros();
+}
+
+void BigUnsigned::subMul(const BigUnsigned& a, const BigUnsigned& b)
+{
+    if (a.len == 0 || b.len == 0)
+        return;
+    if (this == &a || this == &b) {
+        BigUnsigned product;
+        product.multiply(a, b);
+        subtract(*this, product);
+        return;
+    }
+    const BigUnsigned *x = &a, *y = &b;
+    if (a.len < b.len) {
+        x = &b;
+        y = &a;
+    }
+    Index pn = x->len + y->len;
+    // a * b >= 2^(N (pn - 2)), so a shorter *this is certainly smaller.
+    if (len < pn - 1) {
+        len = 0;
+        throw SignError{ "BigUnsigned::subMul", "Negative result in unsigned calculation" };
+    }
+    /* Work modulo 2^(N n), with one block more than either *this or the
+     * product needs: a negative result then shows up as a nonzero top
+     * block. */
+    Index n = ((len > pn) ? len : pn) + 1;
+    allocateAndCopy(n);
+    for (Index i = len; i < n; i++)
+        blk[i] = 0;
+    if (y->len < detail::multiplyKernels().karatsubaThreshold) {
+        for (Index i = 0; i < y->len; i++) {
+            Blk borrow = subMulRow(blk + i, x->blk, x->len, y->blk[i]);
+            subtractBlocksFrom(blk + i + x->len, n - i - x->len, &borrow, 1);
+        }
+    }
+    else {
+        std::vector<Blk> product(pn);
+        detail::multiplyBlocks(product.data(), x->blk, x->len, y->blk, y->len);
+        subtractBlocksFrom(blk, n, product.data(), trimmedLength(product.data(), pn));
+    }
+    if (blk[n - 1] != 0) {
+        len = 0;
+        throw SignError{ "BigUnsigned::subMul", "Negative result in unsigned calculation" };
+    }
+    len = n;
+    zapLeadingZeros();
+}
+
+void BigUnsigned::addMulSmall(const BigUnsigned& a, Blk b)
+{
+    if (a.len == 0 || b == 0)
+        return;
+    Index an = a.len;
+    Index n = ((len > an) ? len : an) + 1;
+    allocateAndCopy(n);
+    for (Index i = len; i < n; i++)
+        blk[i] = 0;
+    // The row may alias *this, but only after the reallocation.
+    const Blk* x = (this == &a) ? blk : a.blk;
+    Blk carry = detail::multiplyKernels().addMulRow(blk, x, an, b);
+    addBlocksInto(blk + an, n - an, &carry, 1);
+    len = n;
+    zapLeadingZeros();
+}
+
+void BigUnsigned::subMulSmall(const BigUnsigned& a, Blk b)
+{
+    if (a.len == 0 || b == 0)
+        return;
+    Index an = a.len;
+    if (len < an) {
+        len = 0;
+        throw SignError{ "BigUnsigned::subMulSmall", "Negative result in unsigned calculation" };
+    }
+    Index n = len + 2;
+    allocateAndCopy(n);
+    blk[len] = blk[len + 1] = 0;
+    const Blk* x = (this == &a) ? blk : a.blk;
+    Blk borrow = subMulRow(blk, x, an, b);
+    subtractBlocksFrom(blk + an, n - an, &borrow, 1);
+    if (blk[n - 1] != 0) {
+        len = 0;
+        throw SignError{ "BigUnsigned::subMulSmall", "Negative result in unsigned calculation" };
+    }
+    len = n;
+    zapLeadingZeros();
+}
+
+namespace {
+/* Shifts x[0..n) left by s < N bits into r[0..n) and returns the bits shifted
+ * out of the top.  r may overlap x if r >= x.  Whole-block moves are left to
+ * memmove, the rest to the shift kernels. */
+Blk shiftBlocksLeft(Blk* r, const Blk* x, Index n, unsigned int s)
+{
+    if (s == 0) {
+        std::copy_backward(x, x + n, r + n);
+        return 0;
+    }
+    return detail::bitwiseKernels().shiftLeft(r, x, n, s);
+}
+
+/* Shifts x[0..n) right by s < N bits into r[0..n).  r may overlap x if
+ * r <= x. */
+void shiftBlocksRight(Blk* r, const Blk* x, Index n, unsigned int s)
+{
+    if (s == 0) {
+        std::copy(x, x + n, r);
+        return;
+    }
+    detail::bitwiseKernels().shiftRight(r, x, n, s);
+}
+
+/* Divides u[0..n) by the single block d and returns the remainder.  The
+ * quotient goes to q[0..n) unless q is null; q may alias u. */
+Blk divideByBlock(const Blk* u, Index n, Blk d, Blk* q)
+{
+    Blk r = 0;
+    for (Index i = n; i > 0; i--) {
+        Blk qi = detail::divBlocks(r, u[i - 1], d, r);
+        if (q != nullptr)
+            q[i - 1] = qi;
+    }
+    return r;
+}
+
+/* Knuth's Algorithm D on normalized operands: divides u[0..un], whose top
+ * block holds the bits shifted out by normalization, by v[0..vn), where
+ * un >= vn >= 2 and the top bit of v[vn - 1] is set.  The quotient goes to
+ * q[0..un - vn] unless q is null, and the remainder is left in u[0..vn). */
+void divideNormalized(Blk* u, Index un, const Blk* v, Index vn, Blk* q)
+{
+    const Blk vTop = v[vn - 1], vNext = v[vn - 2];
+    for (Index j = un - vn + 1; j > 0; j--) {
+        Blk* uj = u + (j - 1);
+        /* Estimate the quotient block from the top two blocks of the
+         * remainder.  Since they are less than vTop * 2^N + 2^N, the
+         * estimate is at most 2^N - 1, and at most two too large. */
+        Blk qhat, rhat;
+        bool rhatOverflow;
+        if (uj[vn] >= vTop) {
+            qhat = ~Blk(0);
+            rhat = uj[vn - 1] + vTop;
+            rhatOverflow = (rhat < vTop);
+        }
+        else {
+            qhat = detail::divBlocks(uj[vn], uj[vn - 1], vTop, rhat);
+            rhatOverflow = false;
+        }
+        // Using the third block catches nearly every estimate that is too large.
+        while (!rhatOverflow) {
+            Blk hi;
+            Blk lo = detail::mulBlocks(qhat, vNext, hi);
+            if (hi < rhat || (hi == rhat && lo <= uj[vn - 2]))
+                break;
+            qhat--;
+            rhat += vTop;
+            rhatOverflow = (rhat < vTop);
+        }
+        // uj[0..vn] -= qhat * v
+        Blk borrow = subMulRow(uj, v, vn, qhat);
+        Blk t = uj[vn];
+        uj[vn] = t - borrow;
+        // In the rare case that qhat was still one too large, add v back.
+        if (t < borrow) {
+            qhat--;
+            Blk carry = 0;
+            for (Index i = 0; i < vn; i++) {
+                Blk x = uj[i] + carry;
+                carry = (x < carry);
+                x += v[i];
+                carry += (x < v[i]);
+                uj[i] = x;
             }
+            uj[vn] += carry;
         }
+        if (q != nullptr)
+            q[j - 1] = qhat;
     }
-    // Zap possible leading zero
-    if (blk[len - 1] == 0)
-        len--;
 }
 
+/* Divides a[0..an) by b[0..bn), where an >= bn >= 1 and b[bn - 1] != 0.
+ * The quotient goes to q[0..an - bn] unless q is null, and the remainder to
+ * work[0..bn).  work must hold an + 1 blocks and may alias a; q must not
+ * alias work, but may alias a when bn == 1. */
+void divideBlocks(Blk* work, const Blk* a, Index an, const Blk* b, Index bn, Blk* q)
+{
+    if (bn == 1) {
+        work[0] = divideByBlock(a, an, b[0], q);
+        return;
+    }
+    // Normalize so that the top bit of the divisor is set.
+    unsigned int s = detail::leadingZeros(b[bn - 1]);
+    std::vector<Blk> shiftedB;
+    const Blk* v = b;
+    if (s != 0) {
+        shiftedB.resize(bn);
+        shiftBlocksLeft(shiftedB.data(), b, bn, s);
+        v = shiftedB.data();
+    }
+    work[an] = shiftBlocksLeft(work, a, an, s);
+    divideNormalized(work, an, v, bn, q);
+    shiftBlocksRight(work, work, bn, s);
+}
+} // namespace
+
 /*
  * DIVISION WITH REMAINDER
  * This monstrous function mods *this by the given divisor b while storing the
@@ -597,144 +976,299 @@ void BigUnsigned::divideWithRemainder(const BigUnsigned& b, BigUnsigned& q)
     }
 
     // At this point we know (*this).len >= b.len > 0.  (Whew!)
+    Index origLen = len;
+    // The extra block holds the bits shifted out by normalization.
+    allocateAndCopy(origLen + 1);
+    q.allocate(origLen - b.len + 1);
+    divideBlocks(blk, blk, origLen, b.blk, b.len, q.blk);
+    q.len = origLen - b.len + 1;
+    q.zapLeadingZeros();
+    len = b.len;
+    zapLeadingZeros();
+}
 
-    /*
-     * Overall method:
-     *
-     * For each appropriate i and i2, decreasing:
-     *    Subtract (b << (i blocks and i2 bits)) from *this, storing the
-     *      result in subtractBuf.
-     *    If the subtraction succeeds with a nonnegative result:
-     *        Turn on bit i2 of block i of the quotient q.
-     *        Copy subtractBuf back into *this.
-     *    Otherwise bit i2 of block i remains off, and *this is unchanged.
-     *
-     * Eventually q will contain the entire quotient, and *this will
-     * be left with the remainder.
-     *
-     * subtractBuf[x] corresponds to blk[x], not blk[x+i], since 2005.01.11.
-     * But on a single iteration, we don't touch the i lowest blocks of blk
-     * (and don't use those of subtractBuf) because these blocks are
-     * unaffected by the subtraction: we are subtracting
-     * (b << (i blocks and i2 bits)), which ends in at least `i' zero
-     * blocks. */
-    // Variables for the calculation
-    Index i, j, k;
-    unsigned int i2;
-    Blk temp;
-    bool borrowIn, borrowOut;
-
-    /*
-     * Make sure we have an extra zero block just past the value.
-     *
-     * When we attempt a subtraction, we might shift `b' so
-     * its first block begins a few bits left of the dividend,
-     * and then we'll try to compare these extra bits with
-     * a nonexistent block to the left of the dividend.  The
-     * extra zero block ensures sensible behavior; we need
-     * an extra block in `subtractBuf' for exactly the same reason.
-     */
-    Index origLen = len; // Save real length.
-    /* To avoid an out-of-bounds access in case of reallocation, allocate
-     * first and then increment the logical length. */
-    allocateAndCopy(len + 1);
-    len++;
-    blk[origLen] = 0; // Zero the added block.
+/*
+ * REMAINDER-ONLY AND QUOTIENT-ONLY DIVISION
+ * `mod' divides in the receiver's own storage and never stores a quotient;
+ * `quotient' writes the quotient into the receiver and keeps the remainder
+ * in a scratch array.
+ */
+void BigUnsigned::mod(const BigUnsigned& a, const BigUnsigned& b)
+{
+    DTRT_ALIASED(this == &b, mod(a, b));
+    if (b.len == 0)
+        throw DivideByZeroError{ "BigUnsigned::mod" };
+    if (a.len < b.len) {
+        operator=(a);
+        return;
+    }
+    Index an = a.len;
+    if (this == &a)
+        allocateAndCopy(an + 1);
+    else
+        allocate(an + 1);
+    divideBlocks(blk, a.blk, an, b.blk, b.len, nullptr);
+    len = b.len;
+    zapLeadingZeros();
+}
 
-    // subtractBuf holds part of the result of a subtraction; see above.
-    Blk* subtractBuf = new Blk[len];
+void BigUnsigned::quotient(const BigUnsigned& a, const BigUnsigned& b)
+{
+    DTRT_ALIASED(this == &a || this == &b, quotient(a, b));
+    if (b.len == 0)
+        throw DivideByZeroError{ "BigUnsigned::quotient" };
+    if (a.len < b.len) {
+        len = 0;
+        return;
+    }
+    // A single-block divisor needs no scratch beyond the remainder block.
+    std::vector<Blk> work(b.len == 1 ? 1 : a.len + 1);
+    allocate(a.len - b.len + 1);
+    divideBlocks(work.data(), a.blk, a.len, b.blk, b.len, blk);
+    len = a.len - b.len + 1;
+    zapLeadingZeros();
+}
 
-    // Set preliminary length for quotient and make room
-    q.len = origLen - b.len + 1;
-    q.allocate(q.len);
-    // Zero out the quotient
-    for (i = 0; i < q.len; i++)
-        q.blk[i] = 0;
-
-    // For each possible left-shift of b in blocks...
-    i = q.len;
-    while (i > 0) {
-        i--;
-        // For each possible left-shift of b in bits...
-        // (Remember, N is the number of bits in a Blk.)
-        q.blk[i] = 0;
-        i2 = N;
-        while (i2 > 0) {
-            i2--;
-            /*
-             * Subtract b, shifted left i blocks and i2 bits, from *this,
-             * and store the answer in subtractBuf.  In the for loop, `k == i + j'.
-             *
-             * Compare this to the middle section of `multiply'.  They
-             * are in many ways analogous.  See especially the discussion
-             * of `getShiftedBlock'.
-             */
-            for (j = 0, k = i, borrowIn = false; j <= b.len; j++, k++) {
-                temp = blk[k] - getShiftedBlock(b, j, i2);
-                borrowOut = (temp > blk[k]);
-                if (borrowIn) {
-                    borrowOut |= (temp == 0);
-                    temp--;
-                }
-                // Since 2005.01.11, indices of `subtractBuf' directly match those of `blk', so use `k'.
-                subtractBuf[k] = temp;
-                borrowIn = borrowOut;
-            }
-            // No more extra iteration to deal with `bHigh'.
-            // Roll-over a borrow as necessary.
-            for (; k < origLen && borrowIn; k++) {
-                borrowIn = (blk[k] == 0);
-                subtractBuf[k] = blk[k] - 1;
-            }
-            /*
-             * If the subtraction was performed successfully (!borrowIn),
-             * set bit i2 in block i of the quotient.
-             *
-             * Then, copy the portion of subtractBuf filled by the subtraction
-             * back to *this.  This portion starts with block i and ends--
-             * where?  Not necessarily at block `i + b.len'!  Well, we
-             * increased k every time we saved a block into subtractBuf, so
-             * the region of subtractBuf we copy is just [i, k).
-             */
-            if (!borrowIn) {
-                q.blk[i] |= (Blk(1) << i2);
-                while (k > i) {
-                    k--;
-                    blk[k] = subtractBuf[k];
-                }
-            }
+/*
+ * EXACT DIVISION
+ * When b is known to divide a, the quotient can be found from the low end
+ * instead of the high end (Jebelean's method, also known as Hensel
+ * division).  After factors of 2 are shifted out, b is odd and therefore
+ * invertible modulo 2^N.  The lowest block of the quotient is then
+ * a[0] * b[0]^(-1) mod 2^N; subtracting q[0] * b clears the lowest block of a,
+ * and the same step repeats on the next block.  Each step is one
+ * multiply-and-subtract pass, with no trial quotients or corrections, and
+ * since the quotient has only an - bn + 1 blocks, any borrow beyond that
+ * point can be dropped.  The blocks of a are overwritten by the quotient as
+ * they are cleared, so no remainder buffer is needed.
+ *
+ * If b does not divide a, the result is meaningless.  When
+ * FBI_CHECK_EXACT_DIVISION is nonzero, which is the default in builds without
+ * NDEBUG, the quotient is multiplied back and a MathError is thrown instead.
+ */
+#ifndef FBI_CHECK_EXACT_DIVISION
+#ifdef NDEBUG
+#define FBI_CHECK_EXACT_DIVISION 0
+#else
+#define FBI_CHECK_EXACT_DIVISION 1
+#endif
+#endif
+
+void BigUnsigned::divideExact(const BigUnsigned& a, const BigUnsigned& b)
+{
+    DTRT_ALIASED(this == &a || this == &b, divideExact(a, b));
+    if (b.len == 0)
+        throw DivideByZeroError{ "BigUnsigned::divideExact" };
+    if (b.len == 1) {
+        divideExact(a, b.blk[0]);
+        return;
+    }
+    Index shift = b.trailingZeros();
+    if (shift != 0) {
+        BigUnsigned a2, b2;
+        a2.bitShiftRight(a, int(shift));
+        b2.bitShiftRight(b, int(shift));
+#if FBI_CHECK_EXACT_DIVISION
+        if (!a.isZero() && a.trailingZeros() < shift)
+            throw MathError{ "BigUnsigned::divideExact", "Divisor does not divide the dividend" };
+#endif
+        divideExact(a2, b2);
+        return;
+    }
+    if (a.len < b.len) {
+#if FBI_CHECK_EXACT_DIVISION
+        if (a.len != 0)
+            throw MathError{ "BigUnsigned::divideExact", "Divisor does not divide the dividend" };
+#endif
+        len = 0;
+        return;
+    }
+    Index qn = a.len - b.len + 1, i, j;
+    allocate(qn);
+    for (i = 0; i < qn; i++)
+        blk[i] = a.blk[i];
+    Blk bInv = detail::inverseBlock(b.blk[0]);
+    for (i = 0; i < qn; i++) {
+        Blk q = blk[i] * bInv;
+        // blk[i..qn) -= q * b, dropping the borrow out of block qn - 1.
+        Blk borrow = 0;
+        for (j = 0; j < b.len && i + j < qn; j++) {
+            Blk hi;
+            Blk lo = detail::mulBlocks(q, b.blk[j], hi);
+            lo += borrow;
+            hi += (lo < borrow);
+            Blk t = blk[i + j];
+            blk[i + j] = t - lo;
+            borrow = hi + (t < lo);
+        }
+        for (j += i; borrow != 0 && j < qn; j++) {
+            Blk t = blk[j];
+            blk[j] = t - borrow;
+            borrow = (t < borrow);
         }
+        // blk[i] is now 0 and can hold the quotient block.
+        blk[i] = q;
+    }
+    len = qn;
+    zapLeadingZeros();
+#if FBI_CHECK_EXACT_DIVISION
+    BigUnsigned product;
+    product.multiply(*this, b);
+    if (product != a)
+        throw MathError{ "BigUnsigned::divideExact", "Divisor does not divide the dividend" };
+#endif
+}
+
+void BigUnsigned::divideExact(const BigUnsigned& a, Blk b)
+{
+    DTRT_ALIASED(this == &a, divideExact(a, b));
+    if (b == 0)
+        throw DivideByZeroError{ "BigUnsigned::divideExact" };
+    unsigned int shift = 0;
+    while ((b & 1) == 0) {
+        b >>= 1;
+        shift++;
+    }
+    if (shift != 0) {
+        BigUnsigned a2;
+        a2.bitShiftRight(a, int(shift));
+#if FBI_CHECK_EXACT_DIVISION
+        if ((a.getBlock(0) & ((Blk(1) << shift) - 1)) != 0)
+            throw MathError{ "BigUnsigned::divideExact", "Divisor does not divide the dividend" };
+#endif
+        divideExact(a2, b);
+        return;
+    }
+    Index n = a.len;
+    allocate(n);
+    Blk bInv = detail::inverseBlock(b), borrow = 0;
+    for (Index i = 0; i < n; i++) {
+        // q = (a[i] - borrow) / b exactly; the high block of q * b joins the borrow.
+        Blk ai = a.blk[i];
+        Blk s = ai - borrow;
+        Blk q = s * bInv;
+        blk[i] = q;
+        Blk hi;
+        detail::mulBlocks(q, b, hi);
+        borrow = hi + (s > ai);
+    }
+    len = n;
+    zapLeadingZeros();
+#if FBI_CHECK_EXACT_DIVISION
+    if (borrow != 0)
+        throw MathError{ "BigUnsigned::divideExact", "Divisor does not divide the dividend" };
+#endif
+}
+
+/*
+ * SINGLE-BLOCK OPERATIONS
+ * Each handles an aliased call in place, like `add'.  They only grow the
+ * array when a carry actually comes out of the top, so `x += 1' almost never
+ * allocates.
+ */
+void BigUnsigned::addSmall(const BigUnsigned& a, Blk b)
+{
+    Index aLen = a.len, i;
+    if (this != &a)
+        allocate(aLen + 1);
+    Blk carry = b;
+    for (i = 0; i < aLen && carry != 0; i++) {
+        Blk t = a.blk[i] + carry;
+        carry = (t < carry);
+        blk[i] = t;
+    }
+    if (this != &a)
+        for (; i < aLen; i++)
+            blk[i] = a.blk[i];
+    len = aLen;
+    if (carry != 0) {
+        allocateAndCopy(len + 1);
+        blk[len++] = carry;
+    }
+}
+
+void BigUnsigned::subtractSmall(const BigUnsigned& a, Blk b)
+{
+    Index aLen = a.len, i;
+    if (a.compareToSmall(b) == less)
+        throw SignError{ "BigUnsigned::subtractSmall", "Negative result in unsigned calculation" };
+    if (this != &a)
+        allocate(aLen);
+    Blk borrow = b;
+    for (i = 0; i < aLen && borrow != 0; i++) {
+        Blk x = a.blk[i];
+        Blk t = x - borrow;
+        borrow = (t > x);
+        blk[i] = t;
+    }
+    if (this != &a)
+        for (; i < aLen; i++)
+            blk[i] = a.blk[i];
+    len = aLen;
+    zapLeadingZeros();
+}
+
+void BigUnsigned::multiplySmall(const BigUnsigned& a, Blk b)
+{
+    if (a.len == 0 || b == 0) {
+        len = 0;
+        return;
+    }
+    Index aLen = a.len;
+    if (this != &a)
+        allocate(aLen + 1);
+    Blk carry = 0;
+    for (Index i = 0; i < aLen; i++) {
+        Blk hi;
+        Blk lo = detail::mulBlocks(a.blk[i], b, hi);
+        lo += carry;
+        carry = hi + (lo < carry);
+        blk[i] = lo;
     }
-    // Zap possible leading zero in quotient
-    if (q.blk[q.len - 1] == 0)
-        q.len--;
-    // Zap any/all leading zeros in remainder
+    len = aLen;
+    if (carry != 0) {
+        allocateAndCopy(len + 1);
+        blk[len++] = carry;
+    }
+}
+
+BigUnsigned::Blk BigUnsigned::quotientSmall(const BigUnsigned& a, Blk b)
+{
+    if (b == 0)
+        throw DivideByZeroError{ "BigUnsigned::quotientSmall" };
+    Index aLen = a.len;
+    if (this != &a)
+        allocate(aLen);
+    Blk r = divideByBlock(a.blk, aLen, b, blk);
+    len = aLen;
     zapLeadingZeros();
-    // Deallocate subtractBuf.
-    // (Thanks to Brad Spencer for noticing my accidental omission of this!)
-    delete[] subtractBuf;
+    return r;
+}
+
+BigUnsigned::Blk BigUnsigned::modSmall(Blk b) const
+{
+    if (b == 0)
+        throw DivideByZeroError{ "BigUnsigned::modSmall" };
+    return divideByBlock(blk, len, b, nullptr);
 }
 
 /* BITWISE OPERATORS
  * These are straightforward blockwise operations except that they differ in
- * the output length and the necessity of zapLeadingZeros. */
+ * the output length and the necessity of zapLeadingZeros.  The blockwise
+ * loops are vector kernels (see Kernels.hh). */
 
 void BigUnsigned::bitAnd(const BigUnsigned& a, const BigUnsigned& b)
 {
-    DTRT_ALIASED(this == &a || this == &b, bitAnd(a, b));
     // The bitwise & can't be longer than either operand.
-    len = (a.len >= b.len) ? b.len : a.len;
-    allocate(len);
-    Index i;
-    for (i = 0; i < len; i++)
-        blk[i] = a.blk[i] & b.blk[i];
+    Index n = (a.len >= b.len) ? b.len : a.len;
+    allocateKeeping(n, this == &a || this == &b);
+    detail::bitwiseKernels().andBlocks(blk, a.blk, b.blk, n);
+    len = n;
     zapLeadingZeros();
 }
 
 void BigUnsigned::bitOr(const BigUnsigned& a, const BigUnsigned& b)
 {
-    DTRT_ALIASED(this == &a || this == &b, bitOr(a, b));
-    Index i;
     const BigUnsigned *a2, *b2;
     if (a.len >= b.len) {
         a2 = &a;
@@ -744,19 +1278,17 @@ void BigUnsigned::bitOr(const BigUnsigned& a, const BigUnsigned& b)
         a2 = &b;
         b2 = &a;
     }
-    allocate(a2->len);
-    for (i = 0; i < b2->len; i++)
-        blk[i] = a2->blk[i] | b2->blk[i];
-    for (; i < a2->len; i++)
-        blk[i] = a2->blk[i];
-    len = a2->len;
+    Index aLen = a2->len, bLen = b2->len;
+    allocateKeeping(aLen, this == &a || this == &b);
+    detail::bitwiseKernels().orBlocks(blk, a2->blk, b2->blk, bLen);
+    if (a2 != this)
+        std::copy(a2->blk + bLen, a2->blk + aLen, blk + bLen);
+    len = aLen;
     // Doesn't need zapLeadingZeros.
 }
 
 void BigUnsigned::bitXor(const BigUnsigned& a, const BigUnsigned& b)
 {
-    DTRT_ALIASED(this == &a || this == &b, bitXor(a, b));
-    Index i;
     const BigUnsigned *a2, *b2;
     if (a.len >= b.len) {
         a2 = &a;
@@ -766,36 +1298,39 @@ void BigUnsigned::bitXor(const BigUnsigned& a, const BigUnsigned& b)
         a2 = &b;
         b2 = &a;
     }
-    allocate(a2->len);
-    for (i = 0; i < b2->len; i++)
-        blk[i] = a2->blk[i] ^ b2->blk[i];
-    for (; i < a2->len; i++)
-        blk[i] = a2->blk[i];
-    len = a2->len;
+    Index aLen = a2->len, bLen = b2->len;
+    allocateKeeping(aLen, this == &a || this == &b);
+    detail::bitwiseKernels().xorBlocks(blk, a2->blk, b2->blk, bLen);
+    if (a2 != this)
+        std::copy(a2->blk + bLen, a2->blk + aLen, blk + bLen);
+    len = aLen;
     zapLeadingZeros();
 }
 
 void BigUnsigned::bitShiftLeft(const BigUnsigned& a, int b)
 {
-    DTRT_ALIASED(this == &a, bitShiftLeft(a, b));
     if (b < 0) {
-        if (b << 1 == 0)
+        if (b == std::numeric_limits<int>::min())
             throw MathError{ "BigUnsigned::bitShiftLeft", "Pathological shift amount not implemented" };
         else {
             bitShiftRight(a, -b);
             return;
         }
     }
+    if (a.len == 0) {
+        len = 0;
+        return;
+    }
     Index shiftBlocks = b / N;
     unsigned int shiftBits = b % N;
+    Index aLen = a.len;
     // + 1: room for high bits nudged left into another block
-    len = a.len + shiftBlocks + 1;
-    allocate(len);
-    Index i, j;
-    for (i = 0; i < shiftBlocks; i++)
-        blk[i] = 0;
-    for (j = 0, i = shiftBlocks; j <= a.len; j++, i++)
-        blk[i] = getShiftedBlock(a, j, shiftBits);
+    Index n = aLen + shiftBlocks + 1;
+    allocateKeeping(n, this == &a);
+    // Top down, so each block of a is read before it is overwritten.
+    blk[n - 1] = shiftBlocksLeft(blk + shiftBlocks, a.blk, aLen, shiftBits);
+    std::fill(blk, blk + shiftBlocks, Blk(0));
+    len = n;
     // Zap possible leading zero
     if (blk[len - 1] == 0)
         len--;
@@ -803,34 +1338,26 @@ void BigUnsigned::bitShiftLeft(const BigUnsigned& a, int b)
 
 void BigUnsigned::bitShiftRight(const BigUnsigned& a, int b)
 {
-    DTRT_ALIASED(this == &a, bitShiftRight(a, b));
     if (b < 0) {
-        if (b << 1 == 0)
+        if (b == std::numeric_limits<int>::min())
             throw MathError{ "BigUnsigned::bitShiftRight", "Pathological shift amount not implemented" };
         else {
             bitShiftLeft(a, -b);
             return;
         }
     }
-    // This calculation is wacky, but expressing the shift as a left bit shift
-    // within each block lets us use getShiftedBlock.
-    Index rightShiftBlocks = (b + N - 1) / N;
-    unsigned int leftShiftBits = N * rightShiftBlocks - b;
-    // Now (N * rightShiftBlocks - leftShiftBits) == b
-    // and 0 <= leftShiftBits < N.
-    if (rightShiftBlocks >= a.len + 1) {
-        // All of a is guaranteed to be shifted off, even considering the left
-        // bit shift.
+    Index shiftBlocks = b / N;
+    unsigned int shiftBits = b % N;
+    if (shiftBlocks >= a.len) {
+        // All of a is shifted off.
         len = 0;
         return;
     }
-    // Now we're allocating a positive amount.
-    // + 1: room for high bits nudged left into another block
-    len = a.len + 1 - rightShiftBlocks;
-    allocate(len);
-    Index i, j;
-    for (j = rightShiftBlocks, i = 0; j <= a.len; j++, i++)
-        blk[i] = getShiftedBlock(a, j, leftShiftBits);
+    Index n = a.len - shiftBlocks;
+    allocateKeeping(n, this == &a);
+    // Bottom up, so each block of a is read before it is overwritten.
+    shiftBlocksRight(blk, a.blk + shiftBlocks, n, shiftBits);
+    len = n;
     // Zap possible leading zero
     if (blk[len - 1] == 0)
         len--;
@@ -865,9 +1392,8 @@ BigUnsigned BigUnsigned::operator/(const BigUnsigned& x) const
 {
     if (x.isZero())
         throw DivideByZeroError{ "BigUnsigned::operator /" };
-    BigUnsigned q, r;
-    r = *this;
-    r.divideWithRemainder(x, q);
+    BigUnsigned q;
+    q.quotient(*this, x);
     return q;
 }
 
@@ -875,9 +1401,8 @@ BigUnsigned BigUnsigned::operator%(const BigUnsigned& x) const
 {
     if (x.isZero())
         throw DivideByZeroError{ "BigUnsigned::operator %" };
-    BigUnsigned q, r;
-    r = *this;
-    r.divideWithRemainder(x, q);
+    BigUnsigned r;
+    r.mod(*this, x);
     return r;
 }
 
@@ -938,13 +1463,7 @@ BigUnsigned& BigUnsigned::operator/=(const BigUnsigned& x)
 {
     if (x.isZero())
         throw DivideByZeroError{ "BigUnsigned::operator /=" };
-    /* The following technique is slightly faster than copying *this first
-     * when x is large. */
-    BigUnsigned q;
-    divideWithRemainder(x, q);
-    // *this contains the remainder, but we overwrite it with the quotient.
-    *this = q;
-
+    quotient(*this, x);
     return *this;
 }
 
@@ -952,10 +1471,7 @@ BigUnsigned& BigUnsigned::operator%=(const BigUnsigned& x)
 {
     if (x.isZero())
         throw DivideByZeroError{ "BigUnsigned::operator %=" };
-    BigUnsigned q;
-    // Mods *this by x.  Don't care about quotient left in q.
-    divideWithRemainder(x, q);
-
+    mod(*this, x);
     return *this;
 }
 
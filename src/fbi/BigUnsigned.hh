@@ -26,6 +26,9 @@ public:
     typedef NumberlikeArray<Blk>::Index Index;
     using NumberlikeArray<Blk>::N;
 
+    // Returned by nextSetBit when there is no set bit to find.
+    static constexpr Index npos = ~Index(0);
+
 protected:
     // Creates a BigUnsigned with a capacity; for internal use.
     BigUnsigned(int, Index c);
@@ -33,6 +36,10 @@ protected:
     // Decreases len to eliminate any leading zero blocks.
     void zapLeadingZeros();
 
+    /* Makes room for c blocks like `allocate', but keeps the current blocks
+     * if `keep' is set, for operations that also read *this as an operand. */
+    void allocateKeeping(Index c, bool keep);
+
 public:
     // Constructs zero.
     BigUnsigned();
@@ -72,6 +79,10 @@ protected:
     void initFromPrimitive(X x);
     template <class X>
     void initFromSignedPrimitive(X x);
+    /* Returns a primitive integer operand as a single block, or throws a
+     * SignError if it is negative. */
+    template <class X>
+    static Blk blockFromPrimitive(X x);
 
 public:
     /* Converters to primitive integer types
@@ -126,10 +137,25 @@ public:
      * necessary. */
     void setBit(Index bi, bool newBit);
 
+    // Returns the number of set bits.
+    Index popCount() const;
+    /* Returns the number of zero bits below the lowest set bit, i.e. the
+     * index of that bit, or 0 if the number is zero. */
+    Index trailingZeros() const;
+    /* Returns the index of the lowest set (or clear) bit at or above bi.
+     * nextSetBit returns npos if there is none; there is always a clear bit
+     * beyond the number's length. */
+    Index nextSetBit(Index bi) const;
+    Index nextClearBit(Index bi) const;
+    // Returns the number of bit positions in which this and x differ.
+    Index hammingDistance(const BigUnsigned& x) const;
+
     // COMPARISONS
 
     // Compares this to x like Perl's <=>
     CmpRes compareTo(const BigUnsigned& x) const;
+    // Ditto for a single block x
+    CmpRes compareToSmall(Blk x) const;
 
     // Ordinary comparison operators
     template <typename Integer>
@@ -220,6 +246,44 @@ public:
      * sense to write quotient and remainder into the same variable. */
     void divideWithRemainder(const BigUnsigned& b, BigUnsigned& q);
 
+    /* `r.mod(a, b)' is like `r = a % b' and `q.quotient(a, b)' is like
+     * `q = a / b', but each computes and stores only its own half of the
+     * division.  Unlike `divideWithRemainder', both throw a
+     * DivideByZeroError if b is 0. */
+    void mod(const BigUnsigned& a, const BigUnsigned& b);
+    void quotient(const BigUnsigned& a, const BigUnsigned& b);
+
+    /* `q.divideExact(a, b)' is like `q = a / b' for a b known to divide a.
+     * It finds the quotient from the low blocks up and is several times
+     * faster than `divideWithRemainder'.  If b does not divide a, the result
+     * is meaningless, except in builds with FBI_CHECK_EXACT_DIVISION (the
+     * default without NDEBUG), which throw a MathError.  Throws a
+     * DivideByZeroError if b is 0.  The second form takes a single-block
+     * divisor. */
+    void divideExact(const BigUnsigned& a, const BigUnsigned& b);
+    void divideExact(const BigUnsigned& a, Blk b);
+
+    /* `r.addMul(a, b)' is like `r += a * b' and `r.subMul(a, b)' is like
+     * `r -= a * b', but the partial products are accumulated straight into
+     * r without building a product temporary.  Like `subtract', `subMul'
+     * throws a SignError and leaves r zero if the result would be negative.
+     * The `Small' forms take a single-block multiplier. */
+    void addMul(const BigUnsigned& a, const BigUnsigned& b);
+    void subMul(const BigUnsigned& a, const BigUnsigned& b);
+    void addMulSmall(const BigUnsigned& a, Blk b);
+    void subMulSmall(const BigUnsigned& a, Blk b);
+
+    /* Single-block versions of `add', `subtract', `multiply' and `quotient'.
+     * The operators taking a primitive integer operand use these, so that
+     * `x += 1' or `x * 10' needs no temporary BigUnsigned.  `quotientSmall'
+     * returns the remainder; it and `modSmall', which returns *this % b,
+     * throw a DivideByZeroError if b is 0. */
+    void addSmall(const BigUnsigned& a, Blk b);
+    void subtractSmall(const BigUnsigned& a, Blk b);
+    void multiplySmall(const BigUnsigned& a, Blk b);
+    Blk quotientSmall(const BigUnsigned& a, Blk b);
+    Blk modSmall(Blk b) const;
+
     /* `divide' and `modulo' are no longer offered.  Use
      * `divideWithRemainder' instead. */
 
@@ -289,9 +353,6 @@ public:
     BigUnsigned& operator--();
     BigUnsigned operator--(int);
 
-    // Helper function that needs access to BigUnsigned internals
-    friend Blk getShiftedBlock(const BigUnsigned& num, Index x, unsigned int y);
-
     // See BigInteger.cc.
     template <class X>
     friend X convertBigUnsignedToPrimitiveAccess(const BigUnsigned& a);
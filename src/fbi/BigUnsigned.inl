@@ -39,6 +39,16 @@ void BigUnsigned::initFromSignedPrimitive(X x)
         initFromPrimitive(x);
 }
 
+template <class X>
+BigUnsigned::Blk BigUnsigned::blockFromPrimitive(X x)
+{
+    static_assert(std::is_integral<X>::value, "Integer type must be integral");
+    if constexpr (std::is_signed<X>::value)
+        if (x < 0)
+            throw SignError{ "BigUnsigned::blockFromPrimitive", "Cannot use a negative number as a BigUnsigned" };
+    return Blk(x);
+}
+
 // CONVERSION TO PRIMITIVE INTEGERS
 
 /* Template with the same idea as initFromPrimitive.  This might be slightly
@@ -80,42 +90,42 @@ template <typename Integer>
 bool BigUnsigned::operator==(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator==(BigUnsigned{ x });
+    return compareToSmall(blockFromPrimitive(x)) == equal;
 }
 
 template <typename Integer>
 bool BigUnsigned::operator!=(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator!=(BigUnsigned{ x });
+    return compareToSmall(blockFromPrimitive(x)) != equal;
 }
 
 template <typename Integer>
 bool BigUnsigned::operator<(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator<(BigUnsigned{ x });
+    return compareToSmall(blockFromPrimitive(x)) == less;
 }
 
 template <typename Integer>
 bool BigUnsigned::operator<=(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator<=(BigUnsigned{ x });
+    return compareToSmall(blockFromPrimitive(x)) != greater;
 }
 
 template <typename Integer>
 bool BigUnsigned::operator>=(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator>=(BigUnsigned{ x });
+    return compareToSmall(blockFromPrimitive(x)) != less;
 }
 
 template <typename Integer>
 bool BigUnsigned::operator>(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator>(BigUnsigned{ x });
+    return compareToSmall(blockFromPrimitive(x)) == greater;
 }
 
 // ======================================================================================== //
@@ -124,56 +134,68 @@ template <typename Integer>
 BigUnsigned BigUnsigned::operator+(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator+(BigUnsigned{ x });
+    BigUnsigned ans;
+    ans.addSmall(*this, blockFromPrimitive(x));
+    return ans;
 }
 
 template <typename Integer>
 BigUnsigned BigUnsigned::operator-(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator-(BigUnsigned{ x });
+    BigUnsigned ans;
+    ans.subtractSmall(*this, blockFromPrimitive(x));
+    return ans;
 }
 
 template <typename Integer>
 BigUnsigned BigUnsigned::operator*(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator*(BigUnsigned{ x });
+    BigUnsigned ans;
+    ans.multiplySmall(*this, blockFromPrimitive(x));
+    return ans;
 }
 
 template <typename Integer>
 BigUnsigned BigUnsigned::operator/(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator/(BigUnsigned{ x });
+    BigUnsigned ans;
+    ans.quotientSmall(*this, blockFromPrimitive(x));
+    return ans;
 }
 
 template <typename Integer>
 BigUnsigned BigUnsigned::operator%(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator%(BigUnsigned{ x });
+    return BigUnsigned{ modSmall(blockFromPrimitive(x)) };
 }
 
 template <typename Integer>
 BigUnsigned BigUnsigned::operator&(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator&(BigUnsigned{ x });
+    return BigUnsigned{ getBlock(0) & blockFromPrimitive(x) };
 }
 
 template <typename Integer>
 BigUnsigned BigUnsigned::operator|(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator|(BigUnsigned{ x });
+    BigUnsigned ans(*this);
+    ans.setBlock(0, getBlock(0) | blockFromPrimitive(x));
+    return ans;
 }
 
 template <typename Integer>
 BigUnsigned BigUnsigned::operator^(const Integer& x) const
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator^(BigUnsigned{ x });
+    BigUnsigned ans(*this);
+    ans.setBlock(0, getBlock(0) ^ blockFromPrimitive(x));
+    return ans;
 }
 
 // ======================================================================================== //
@@ -182,54 +204,66 @@ template <typename Integer>
 BigUnsigned& BigUnsigned::operator+=(const Integer& x)
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator+=(BigUnsigned{ x });
+    addSmall(*this, blockFromPrimitive(x));
+    return *this;
 }
 
 template <typename Integer>
 BigUnsigned& BigUnsigned::operator-=(const Integer& x)
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator-=(BigUnsigned{ x });
+    subtractSmall(*this, blockFromPrimitive(x));
+    return *this;
 }
 
 template <typename Integer>
 BigUnsigned& BigUnsigned::operator*=(const Integer& x)
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator*=(BigUnsigned{ x });
+    multiplySmall(*this, blockFromPrimitive(x));
+    return *this;
 }
 
 template <typename Integer>
 BigUnsigned& BigUnsigned::operator/=(const Integer& x)
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator/=(BigUnsigned{ x });
+    quotientSmall(*this, blockFromPrimitive(x));
+    return *this;
 }
 
 template <typename Integer>
 BigUnsigned& BigUnsigned::operator%=(const Integer& x)
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator%=(BigUnsigned{ x });
+    Blk r = modSmall(blockFromPrimitive(x));
+    len = 0;
+    setBlock(0, r);
+    return *this;
 }
 
 template <typename Integer>
 BigUnsigned& BigUnsigned::operator&=(const Integer& x)
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator&=(BigUnsigned{ x });
+    Blk b = getBlock(0) & blockFromPrimitive(x);
+    len = 0;
+    setBlock(0, b);
+    return *this;
 }
 
 template <typename Integer>
 BigUnsigned& BigUnsigned::operator|=(const Integer& x)
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator|=(BigUnsigned{ x });
+    setBlock(0, getBlock(0) | blockFromPrimitive(x));
+    return *this;
 }
 
 template <typename Integer>
 BigUnsigned& BigUnsigned::operator^=(const Integer& x)
 {
     static_assert(std::is_arithmetic<Integer>::value, "Integer type must be arithmetic");
-    return operator^=(BigUnsigned{ x });
+    setBlock(0, getBlock(0) ^ blockFromPrimitive(x));
+    return *this;
 }
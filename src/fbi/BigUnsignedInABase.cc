@@ -3,7 +3,7 @@
 #include <stdexcept>
 
 namespace fbi {
-BigUnsignedInABase::BigUnsignedInABase(int, Index c) : NumberlikeArray<Digit>(0, c) {}
+BigUnsignedInABase::BigUnsignedInABase(int, Index c) : NumberlikeArray<Digit>(c) {}
 
 void BigUnsignedInABase::zapLeadingZeros()
 
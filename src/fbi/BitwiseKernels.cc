@@ -0,0 +1,474 @@
+#include "Kernels.hh"
+
+#include "BlockArithmetic.hh"
+#include "CpuFeatures.hh"
+
+#ifdef FBI_X86_64_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace fbi {
+namespace detail {
+namespace {
+#ifdef FBI_X86_64_KERNELS
+#define FBI_AVX2 __attribute__((target("avx2")))
+#define FBI_AVX512 __attribute__((target("avx512f")))
+#define FBI_VPOPCNTDQ __attribute__((target("avx512f,avx512vpopcntdq")))
+#endif
+
+/* The operators apply to single blocks and to whole vectors of them.  SSE2 is
+ * part of x86-64, so the 128-bit versions need no target attribute. */
+struct And {
+    static Blk apply(Blk a, Blk b) { return a & b; }
+#ifdef FBI_X86_64_KERNELS
+    static __m128i apply(__m128i a, __m128i b) { return _mm_and_si128(a, b); }
+    FBI_AVX2 static __m256i apply(__m256i a, __m256i b) { return _mm256_and_si256(a, b); }
+    FBI_AVX512 static __m512i apply(__m512i a, __m512i b) { return _mm512_and_si512(a, b); }
+#endif
+};
+
+struct Or {
+    static Blk apply(Blk a, Blk b) { return a | b; }
+#ifdef FBI_X86_64_KERNELS
+    static __m128i apply(__m128i a, __m128i b) { return _mm_or_si128(a, b); }
+    FBI_AVX2 static __m256i apply(__m256i a, __m256i b) { return _mm256_or_si256(a, b); }
+    FBI_AVX512 static __m512i apply(__m512i a, __m512i b) { return _mm512_or_si512(a, b); }
+#endif
+};
+
+struct Xor {
+    static Blk apply(Blk a, Blk b) { return a ^ b; }
+#ifdef FBI_X86_64_KERNELS
+    static __m128i apply(__m128i a, __m128i b) { return _mm_xor_si128(a, b); }
+    FBI_AVX2 static __m256i apply(__m256i a, __m256i b) { return _mm256_xor_si256(a, b); }
+    FBI_AVX512 static __m512i apply(__m512i a, __m512i b) { return _mm512_xor_si512(a, b); }
+#endif
+};
+
+template <class Op>
+void bitwiseGeneric(Blk* r, const Blk* a, const Blk* b, Index n)
+{
+    for (Index i = 0; i < n; i++)
+        r[i] = Op::apply(a[i], b[i]);
+}
+
+Index highestDifferenceGeneric(const Blk* a, const Blk* b, Index n)
+{
+    while (n > 0 && a[n - 1] == b[n - 1])
+        n--;
+    return n;
+}
+
+Blk shiftLeftGeneric(Blk* r, const Blk* x, Index n, unsigned int s)
+{
+    Blk out = x[n - 1] >> (BigUnsigned::N - s);
+    for (Index i = n - 1; i > 0; i--)
+        r[i] = (x[i] << s) | (x[i - 1] >> (BigUnsigned::N - s));
+    r[0] = x[0] << s;
+    return out;
+}
+
+void shiftRightGeneric(Blk* r, const Blk* x, Index n, unsigned int s)
+{
+    for (Index i = 0; i + 1 < n; i++)
+        r[i] = (x[i] >> s) | (x[i + 1] << (BigUnsigned::N - s));
+    r[n - 1] = x[n - 1] >> s;
+}
+
+Index popCountGeneric(const Blk* a, Index n)
+{
+    Index count = 0;
+    for (Index i = 0; i < n; i++)
+        count += popCount(a[i]);
+    return count;
+}
+
+Index hammingDistanceGeneric(const Blk* a, const Blk* b, Index n)
+{
+    Index count = 0;
+    for (Index i = 0; i < n; i++)
+        count += popCount(a[i] ^ b[i]);
+    return count;
+}
+
+#ifdef FBI_X86_64_KERNELS
+/* The vector kernels use unaligned loads and stores throughout: the block
+ * arrays come from new[], which only guarantees 16-byte alignment, and on
+ * current processors unaligned accesses cost nothing extra unless they cross
+ * a cache line.  Each highestDifference kernel ORs together the differences
+ * of a few vectors, working down from the top, and only looks at single
+ * blocks once it has found a group that differs.
+ *
+ * The shift kernels combine each vector of x with the same vector loaded one
+ * block further down (left shifts) or up (right shifts).  Both loads come
+ * before the store and the loop runs in the same direction as the scalar one,
+ * so r may overlap x just as it may there. */
+
+template <class Op>
+void bitwiseSse2(Blk* r, const Blk* a, const Blk* b, Index n)
+{
+    Index i = 0;
+    for (; n - i >= 4; i += 4) {
+        __m128i x0 = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i x1 = _mm_loadu_si128((const __m128i*)(a + i + 2));
+        __m128i y0 = _mm_loadu_si128((const __m128i*)(b + i));
+        __m128i y1 = _mm_loadu_si128((const __m128i*)(b + i + 2));
+        _mm_storeu_si128((__m128i*)(r + i), Op::apply(x0, y0));
+        _mm_storeu_si128((__m128i*)(r + i + 2), Op::apply(x1, y1));
+    }
+    for (; i < n; i++)
+        r[i] = Op::apply(a[i], b[i]);
+}
+
+Index highestDifferenceSse2(const Blk* a, const Blk* b, Index n)
+{
+    Index i = n;
+    while (i >= 4) {
+        i -= 4;
+        __m128i d0 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(a + i)),
+                                   _mm_loadu_si128((const __m128i*)(b + i)));
+        __m128i d1 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(a + i + 2)),
+                                   _mm_loadu_si128((const __m128i*)(b + i + 2)));
+        __m128i zero = _mm_cmpeq_epi8(_mm_or_si128(d0, d1), _mm_setzero_si128());
+        if (_mm_movemask_epi8(zero) != 0xffff)
+            return i + highestDifferenceGeneric(a + i, b + i, 4);
+    }
+    return highestDifferenceGeneric(a, b, i);
+}
+
+Blk shiftLeftSse2(Blk* r, const Blk* x, Index n, unsigned int s)
+{
+    Blk out = x[n - 1] >> (BigUnsigned::N - s);
+    __m128i left = _mm_cvtsi32_si128(int(s)), right = _mm_cvtsi32_si128(int(BigUnsigned::N - s));
+    Index i = n;
+    while (i > 2) {
+        i -= 2;
+        __m128i hi = _mm_loadu_si128((const __m128i*)(x + i)), lo = _mm_loadu_si128((const __m128i*)(x + i - 1));
+        _mm_storeu_si128((__m128i*)(r + i), _mm_or_si128(_mm_sll_epi64(hi, left), _mm_srl_epi64(lo, right)));
+    }
+    for (; i > 1; i--)
+        r[i - 1] = (x[i - 1] << s) | (x[i - 2] >> (BigUnsigned::N - s));
+    r[0] = x[0] << s;
+    return out;
+}
+
+void shiftRightSse2(Blk* r, const Blk* x, Index n, unsigned int s)
+{
+    __m128i left = _mm_cvtsi32_si128(int(BigUnsigned::N - s)), right = _mm_cvtsi32_si128(int(s));
+    Index i = 0;
+    for (; n - i > 2; i += 2) {
+        __m128i lo = _mm_loadu_si128((const __m128i*)(x + i)), hi = _mm_loadu_si128((const __m128i*)(x + i + 1));
+        _mm_storeu_si128((__m128i*)(r + i), _mm_or_si128(_mm_srl_epi64(lo, right), _mm_sll_epi64(hi, left)));
+    }
+    for (; i + 1 < n; i++)
+        r[i] = (x[i] >> s) | (x[i + 1] << (BigUnsigned::N - s));
+    r[n - 1] = x[n - 1] >> s;
+}
+
+template <class Op>
+FBI_AVX2 void bitwiseAvx2(Blk* r, const Blk* a, const Blk* b, Index n)
+{
+    Index i = 0;
+    for (; n - i >= 8; i += 8) {
+        __m256i x0 = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i x1 = _mm256_loadu_si256((const __m256i*)(a + i + 4));
+        __m256i y0 = _mm256_loadu_si256((const __m256i*)(b + i));
+        __m256i y1 = _mm256_loadu_si256((const __m256i*)(b + i + 4));
+        _mm256_storeu_si256((__m256i*)(r + i), Op::apply(x0, y0));
+        _mm256_storeu_si256((__m256i*)(r + i + 4), Op::apply(x1, y1));
+    }
+    for (; i < n; i++)
+        r[i] = Op::apply(a[i], b[i]);
+}
+
+FBI_AVX2 Index highestDifferenceAvx2(const Blk* a, const Blk* b, Index n)
+{
+    Index i = n;
+    while (i >= 8) {
+        i -= 8;
+        __m256i d0 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(a + i)),
+                                      _mm256_loadu_si256((const __m256i*)(b + i)));
+        __m256i d1 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(a + i + 4)),
+                                      _mm256_loadu_si256((const __m256i*)(b + i + 4)));
+        __m256i d = _mm256_or_si256(d0, d1);
+        if (!_mm256_testz_si256(d, d))
+            return i + highestDifferenceGeneric(a + i, b + i, 8);
+    }
+    return highestDifferenceGeneric(a, b, i);
+}
+
+FBI_AVX2 Blk shiftLeftAvx2(Blk* r, const Blk* x, Index n, unsigned int s)
+{
+    Blk out = x[n - 1] >> (BigUnsigned::N - s);
+    __m128i left = _mm_cvtsi32_si128(int(s)), right = _mm_cvtsi32_si128(int(BigUnsigned::N - s));
+    Index i = n;
+    while (i > 4) {
+        i -= 4;
+        __m256i hi = _mm256_loadu_si256((const __m256i*)(x + i)), lo = _mm256_loadu_si256((const __m256i*)(x + i - 1));
+        _mm256_storeu_si256((__m256i*)(r + i),
+                            _mm256_or_si256(_mm256_sll_epi64(hi, left), _mm256_srl_epi64(lo, right)));
+    }
+    for (; i > 1; i--)
+        r[i - 1] = (x[i - 1] << s) | (x[i - 2] >> (BigUnsigned::N - s));
+    r[0] = x[0] << s;
+    return out;
+}
+
+FBI_AVX2 void shiftRightAvx2(Blk* r, const Blk* x, Index n, unsigned int s)
+{
+    __m128i left = _mm_cvtsi32_si128(int(BigUnsigned::N - s)), right = _mm_cvtsi32_si128(int(s));
+    Index i = 0;
+    for (; n - i > 4; i += 4) {
+        __m256i lo = _mm256_loadu_si256((const __m256i*)(x + i)), hi = _mm256_loadu_si256((const __m256i*)(x + i + 1));
+        _mm256_storeu_si256((__m256i*)(r + i),
+                            _mm256_or_si256(_mm256_srl_epi64(lo, right), _mm256_sll_epi64(hi, left)));
+    }
+    for (; i + 1 < n; i++)
+        r[i] = (x[i] >> s) | (x[i + 1] << (BigUnsigned::N - s));
+    r[n - 1] = x[n - 1] >> s;
+}
+
+/* Population count by nibble lookup (Mula's method): vpshufb counts the bits
+ * of every nibble, and vpsadbw sums the byte counts of each block. */
+FBI_AVX2 __m256i popCountVector(__m256i v)
+{
+    const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                           0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    __m256i lo = _mm256_shuffle_epi8(table, _mm256_and_si256(v, nibble));
+    __m256i hi = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+    return _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256());
+}
+
+FBI_AVX2 Index sumBlocks(__m256i v)
+{
+    __m128i s = _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    return Index(_mm_cvtsi128_si64(s) + _mm_extract_epi64(s, 1));
+}
+
+FBI_AVX2 Index popCountAvx2(const Blk* a, Index n)
+{
+    __m256i count = _mm256_setzero_si256();
+    Index i = 0;
+    for (; n - i >= 4; i += 4)
+        count = _mm256_add_epi64(count, popCountVector(_mm256_loadu_si256((const __m256i*)(a + i))));
+    return sumBlocks(count) + popCountGeneric(a + i, n - i);
+}
+
+FBI_AVX2 Index hammingDistanceAvx2(const Blk* a, const Blk* b, Index n)
+{
+    __m256i count = _mm256_setzero_si256();
+    Index i = 0;
+    for (; n - i >= 4; i += 4) {
+        __m256i d = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(a + i)),
+                                     _mm256_loadu_si256((const __m256i*)(b + i)));
+        count = _mm256_add_epi64(count, popCountVector(d));
+    }
+    return sumBlocks(count) + hammingDistanceGeneric(a + i, b + i, n - i);
+}
+
+// The last partial vector is loaded and stored under a mask.
+template <class Op>
+FBI_AVX512 void bitwiseAvx512(Blk* r, const Blk* a, const Blk* b, Index n)
+{
+    Index i = 0;
+    for (; n - i >= 16; i += 16) {
+        __m512i x0 = _mm512_loadu_si512(a + i), x1 = _mm512_loadu_si512(a + i + 8);
+        __m512i y0 = _mm512_loadu_si512(b + i), y1 = _mm512_loadu_si512(b + i + 8);
+        _mm512_storeu_si512(r + i, Op::apply(x0, y0));
+        _mm512_storeu_si512(r + i + 8, Op::apply(x1, y1));
+    }
+    for (; i < n; i += 8) {
+        __mmask8 m = (n - i >= 8) ? __mmask8(0xff) : __mmask8((1u << (n - i)) - 1);
+        __m512i x = _mm512_maskz_loadu_epi64(m, a + i), y = _mm512_maskz_loadu_epi64(m, b + i);
+        _mm512_mask_storeu_epi64(r + i, m, Op::apply(x, y));
+    }
+}
+
+FBI_AVX512 Index highestDifferenceAvx512(const Blk* a, const Blk* b, Index n)
+{
+    Index i = n;
+    while (i >= 16) {
+        i -= 16;
+        __m512i d0 = _mm512_xor_si512(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+        __m512i d1 = _mm512_xor_si512(_mm512_loadu_si512(a + i + 8), _mm512_loadu_si512(b + i + 8));
+        __m512i d = _mm512_or_si512(d0, d1);
+        if (_mm512_test_epi64_mask(d, d) != 0)
+            return i + highestDifferenceGeneric(a + i, b + i, 16);
+    }
+    return highestDifferenceGeneric(a, b, i);
+}
+
+/* GCC 12 warns that the AVX-512 headers read an undefined vector behind the
+ * shifts by an __m128i count (GCC bug 105593). */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+FBI_AVX512 Blk shiftLeftAvx512(Blk* r, const Blk* x, Index n, unsigned int s)
+{
+    Blk out = x[n - 1] >> (BigUnsigned::N - s);
+    __m128i left = _mm_cvtsi32_si128(int(s)), right = _mm_cvtsi32_si128(int(BigUnsigned::N - s));
+    Index i = n;
+    while (i > 8) {
+        i -= 8;
+        __m512i hi = _mm512_loadu_si512(x + i), lo = _mm512_loadu_si512(x + i - 1);
+        _mm512_storeu_si512(r + i, _mm512_or_si512(_mm512_sll_epi64(hi, left), _mm512_srl_epi64(lo, right)));
+    }
+    for (; i > 1; i--)
+        r[i - 1] = (x[i - 1] << s) | (x[i - 2] >> (BigUnsigned::N - s));
+    r[0] = x[0] << s;
+    return out;
+}
+
+FBI_AVX512 void shiftRightAvx512(Blk* r, const Blk* x, Index n, unsigned int s)
+{
+    __m128i left = _mm_cvtsi32_si128(int(BigUnsigned::N - s)), right = _mm_cvtsi32_si128(int(s));
+    Index i = 0;
+    for (; n - i > 8; i += 8) {
+        __m512i lo = _mm512_loadu_si512(x + i), hi = _mm512_loadu_si512(x + i + 1);
+        _mm512_storeu_si512(r + i, _mm512_or_si512(_mm512_srl_epi64(lo, right), _mm512_sll_epi64(hi, left)));
+    }
+    for (; i + 1 < n; i++)
+        r[i] = (x[i] >> s) | (x[i + 1] << (BigUnsigned::N - s));
+    r[n - 1] = x[n - 1] >> s;
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+/* The sum of the lanes of x.  Goes through memory rather than
+ * _mm512_reduce_add_epi64, whose GCC 12 implementation reads an undefined
+ * vector and draws -Wuninitialized. */
+FBI_VPOPCNTDQ inline Index sumLanes(__m512i x)
+{
+    alignas(64) Blk lanes[8];
+    _mm512_store_si512(lanes, x);
+    Blk sum = 0;
+    for (Blk lane : lanes)
+        sum += lane;
+    return Index(sum);
+}
+
+// vpopcntq counts each block's bits directly; the tail is loaded under a mask.
+FBI_VPOPCNTDQ Index popCountVpopcntdq(const Blk* a, Index n)
+{
+    __m512i count = _mm512_setzero_si512();
+    for (Index i = 0; i < n; i += 8) {
+        __mmask8 m = (n - i >= 8) ? __mmask8(0xff) : __mmask8((1u << (n - i)) - 1);
+        count = _mm512_add_epi64(count, _mm512_popcnt_epi64(_mm512_maskz_loadu_epi64(m, a + i)));
+    }
+    return sumLanes(count);
+}
+
+FBI_VPOPCNTDQ Index hammingDistanceVpopcntdq(const Blk* a, const Blk* b, Index n)
+{
+    __m512i count = _mm512_setzero_si512();
+    for (Index i = 0; i < n; i += 8) {
+        __mmask8 m = (n - i >= 8) ? __mmask8(0xff) : __mmask8((1u << (n - i)) - 1);
+        __m512i d = _mm512_xor_si512(_mm512_maskz_loadu_epi64(m, a + i), _mm512_maskz_loadu_epi64(m, b + i));
+        count = _mm512_add_epi64(count, _mm512_popcnt_epi64(d));
+    }
+    return sumLanes(count);
+}
+
+#undef FBI_AVX2
+#undef FBI_AVX512
+#undef FBI_VPOPCNTDQ
+#endif
+
+std::vector<const BitwiseKernels*> supportedBitwiseKernels()
+{
+    std::vector<const BitwiseKernels*> k{ &genericBitwiseKernels };
+#ifdef FBI_X86_64_KERNELS
+    const CpuFeatures& f = cpuFeatures();
+    k.push_back(&sse2BitwiseKernels);
+    if (f.avx2)
+        k.push_back(&avx2BitwiseKernels);
+    if (f.avx2 && f.avx512f)
+        k.push_back(&avx512BitwiseKernels);
+    if (f.avx2 && f.avx512f && f.avx512vpopcntdq)
+        k.push_back(&vpopcntdqBitwiseKernels);
+#endif
+    return k;
+}
+
+// The last supported family is the widest, and the fastest.
+const BitwiseKernels*& activeBitwiseKernels()
+{
+    static const BitwiseKernels* active = availableBitwiseKernels().back();
+    return active;
+}
+} // namespace
+
+const BitwiseKernels genericBitwiseKernels = { "generic",
+                                               bitwiseGeneric<And>,
+                                               bitwiseGeneric<Or>,
+                                               bitwiseGeneric<Xor>,
+                                               highestDifferenceGeneric,
+                                               shiftLeftGeneric,
+                                               shiftRightGeneric,
+                                               popCountGeneric,
+                                               hammingDistanceGeneric };
+
+#ifdef FBI_X86_64_KERNELS
+const BitwiseKernels sse2BitwiseKernels = { "sse2",
+                                            bitwiseSse2<And>,
+                                            bitwiseSse2<Or>,
+                                            bitwiseSse2<Xor>,
+                                            highestDifferenceSse2,
+                                            shiftLeftSse2,
+                                            shiftRightSse2,
+                                            popCountGeneric,
+                                            hammingDistanceGeneric };
+
+const BitwiseKernels avx2BitwiseKernels = { "avx2",
+                                            bitwiseAvx2<And>,
+                                            bitwiseAvx2<Or>,
+                                            bitwiseAvx2<Xor>,
+                                            highestDifferenceAvx2,
+                                            shiftLeftAvx2,
+                                            shiftRightAvx2,
+                                            popCountAvx2,
+                                            hammingDistanceAvx2 };
+
+// AVX-512F has no byte shuffle, so the avx512 family counts bits with AVX2.
+const BitwiseKernels avx512BitwiseKernels = { "avx512",
+                                              bitwiseAvx512<And>,
+                                              bitwiseAvx512<Or>,
+                                              bitwiseAvx512<Xor>,
+                                              highestDifferenceAvx512,
+                                              shiftLeftAvx512,
+                                              shiftRightAvx512,
+                                              popCountAvx2,
+                                              hammingDistanceAvx2 };
+
+// The avx512 family with vpopcntq for population counts.
+const BitwiseKernels vpopcntdqBitwiseKernels = { "avx512-vpopcntdq",
+                                                 bitwiseAvx512<And>,
+                                                 bitwiseAvx512<Or>,
+                                                 bitwiseAvx512<Xor>,
+                                                 highestDifferenceAvx512,
+                                                 shiftLeftAvx512,
+                                                 shiftRightAvx512,
+                                                 popCountVpopcntdq,
+                                                 hammingDistanceVpopcntdq };
+#endif
+
+const BitwiseKernels& bitwiseKernels()
+{
+    return *activeBitwiseKernels();
+}
+
+const std::vector<const BitwiseKernels*>& availableBitwiseKernels()
+{
+    static const std::vector<const BitwiseKernels*> kernels = supportedBitwiseKernels();
+    return kernels;
+}
+
+void selectBitwiseKernels(const BitwiseKernels& kernels)
+{
+    activeBitwiseKernels() = &kernels;
+}
+} // namespace detail
+} // namespace fbi
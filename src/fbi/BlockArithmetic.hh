@@ -0,0 +1,212 @@
+#pragma once
+
+#include "BigUnsigned.hh"
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#elif defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+namespace fbi {
+namespace detail {
+/* Single-block arithmetic helpers shared by the multi-block routines.
+ *
+ * These are the ``b_0'' (one-place by one-place multiplication giving a
+ * two-place answer) building blocks that the comment above
+ * BigUnsigned::multiply wishes for.  Each one uses the widest operation the
+ * compiler offers and falls back to portable half-block arithmetic. */
+
+typedef BigUnsigned::Blk Blk;
+typedef BigUnsigned::Index Index;
+
+// Returns the low block of a * b and stores the high block in hi.
+inline Blk mulBlocks(Blk a, Blk b, Blk& hi)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 p = (unsigned __int128)a * b;
+    hi = Blk(p >> 64);
+    return Blk(p);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return _umul128(a, b, &hi);
+#else
+    const unsigned int halfN = BigUnsigned::N / 2;
+    const Blk lowMask = (Blk(1) << halfN) - 1;
+    Blk aLo = a & lowMask, aHi = a >> halfN;
+    Blk bLo = b & lowMask, bHi = b >> halfN;
+    Blk ll = aLo * bLo, lh = aLo * bHi, hl = aHi * bLo, hh = aHi * bHi;
+    // Sum of the middle partial products and the carry out of ll.
+    Blk mid = (ll >> halfN) + (lh & lowMask) + (hl & lowMask);
+    hi = hh + (lh >> halfN) + (hl >> halfN) + (mid >> halfN);
+    return (mid << halfN) | (ll & lowMask);
+#endif
+}
+
+/* Returns a + b + carry, where carry is 0 or 1, and stores the carry out in
+ * carry.  On x86-64 this is a single add-with-carry instruction. */
+inline Blk addCarry(Blk a, Blk b, Blk& carry)
+{
+#if defined(__x86_64__) || (defined(_MSC_VER) && defined(_M_X64))
+    unsigned long long sum;
+    carry = _addcarry_u64((unsigned char)carry, a, b, &sum);
+    return sum;
+#else
+    Blk sum = a + carry;
+    carry = (sum < carry);
+    sum += b;
+    carry += (sum < b);
+    return sum;
+#endif
+}
+
+// Returns a - b - borrow, where borrow is 0 or 1, and stores the borrow out in borrow.
+inline Blk subBorrow(Blk a, Blk b, Blk& borrow)
+{
+#if defined(__x86_64__) || (defined(_MSC_VER) && defined(_M_X64))
+    unsigned long long diff;
+    borrow = _subborrow_u64((unsigned char)borrow, a, b, &diff);
+    return diff;
+#else
+    Blk diff = a - b;
+    Blk b1 = (diff > a);
+    Blk diff2 = diff - borrow;
+    borrow = b1 | (diff2 > diff);
+    return diff2;
+#endif
+}
+
+// Returns the number of leading zero bits of the nonzero x.
+inline unsigned int leadingZeros(Blk x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return unsigned(__builtin_clzll(x));
+#else
+    unsigned int n = 0;
+    while ((x >> (BigUnsigned::N - 1)) == 0) {
+        x <<= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+// Returns the number of trailing zero bits of the nonzero x.
+inline unsigned int trailingZeros(Blk x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return unsigned(__builtin_ctzll(x));
+#else
+    unsigned int n = 0;
+    while ((x & 1) == 0) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+// Returns the number of set bits of x.
+inline unsigned int popCount(Blk x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return unsigned(__builtin_popcountll(x));
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return unsigned((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/* Returns (hi * 2^N + lo) / d and stores the remainder in r.  Requires
+ * hi < d, so the quotient fits in one block.  This is the ``c_0'' building
+ * block of Knuth's Algorithm D. */
+inline Blk divBlocks(Blk hi, Blk lo, Blk d, Blk& r)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 u = ((unsigned __int128)hi << 64) | lo;
+    Blk q = Blk(u / d);
+    r = lo - q * d;
+    return q;
+#else
+    /* Long division in half blocks (Hacker's Delight, divlu): normalize d so
+     * its top bit is set, then find each half of the quotient from an
+     * estimate that is at most two too large. */
+    const unsigned int halfN = BigUnsigned::N / 2;
+    const Blk half = Blk(1) << halfN, lowMask = half - 1;
+    unsigned int s = leadingZeros(d);
+    d <<= s;
+    Blk u32 = (s == 0) ? hi : (hi << s) | (lo >> (BigUnsigned::N - s));
+    Blk u10 = lo << s;
+    Blk u1 = u10 >> halfN, u0 = u10 & lowMask;
+    Blk d1 = d >> halfN, d0 = d & lowMask;
+
+    Blk q1 = u32 / d1, rhat = u32 - q1 * d1;
+    while (q1 >= half || q1 * d0 > ((rhat << halfN) | u1)) {
+        q1--;
+        rhat += d1;
+        if (rhat >= half)
+            break;
+    }
+    Blk u21 = (u32 << halfN) + u1 - q1 * d;
+    Blk q0 = u21 / d1;
+    rhat = u21 - q0 * d1;
+    while (q0 >= half || q0 * d0 > ((rhat << halfN) | u0)) {
+        q0--;
+        rhat += d1;
+        if (rhat >= half)
+            break;
+    }
+    r = ((u21 << halfN) + u0 - q0 * d) >> s;
+    return (q1 << halfN) | q0;
+#endif
+}
+
+// Returns b^(-1) mod 2^N for odd b.
+inline Blk inverseBlock(Blk b)
+{
+    /* Newton's iteration x <- x (2 - b x) doubles the number of correct low
+     * bits of x.  x = b is already correct to 3 bits. */
+    Blk x = b;
+    for (int i = 0; i < 6; i++)
+        x *= 2 - b * x;
+    return x;
+}
+
+/* Returns a block of all ones if condition holds and 0 otherwise.  The
+ * subtraction compiles to straight-line code, so selections built from this
+ * mask take the same time either way. */
+inline Blk maskIf(bool condition)
+{
+    return Blk(0) - Blk(condition);
+}
+
+// Swaps a[0..len) and b[0..len) if mask is all ones; leaves them alone if it is 0.
+inline void conditionalSwap(Blk* a, Blk* b, Index len, Blk mask)
+{
+    for (Index i = 0; i < len; i++) {
+        Blk x = (a[i] ^ b[i]) & mask;
+        a[i] ^= x;
+        b[i] ^= x;
+    }
+}
+
+/* MULTI-BLOCK KERNELS
+ * These work on plain block arrays and are defined in BigUnsigned.cc. */
+
+/* r[0..n) = x[0..n) + y[0..n); returns the carry out of the top block.  r may
+ * alias x or y. */
+Blk addBlocks(Blk* r, const Blk* x, const Blk* y, Index n);
+/* r[0..n) = x[0..n) - y[0..n); returns the borrow out of the top block.  r
+ * may alias x or y. */
+Blk subtractBlocks(Blk* r, const Blk* x, const Blk* y, Index n);
+
+/* r[0..an+bn) = a[0..an) * b[0..bn), where an >= bn.  r must not overlap a
+ * or b.  Short operands go to the basecase kernels of multiplyKernels(), and
+ * long ones are split by Karatsuba's method first. */
+void multiplyBlocks(Blk* r, const Blk* a, Index an, const Blk* b, Index bn);
+/* r[0..2n) = a[0..n)^2.  r must not overlap a.  Long operands are squared
+ * with Karatsuba's method. */
+void squareBlocks(Blk* r, const Blk* a, Index n);
+} // namespace detail
+} // namespace fbi
@@ -0,0 +1,80 @@
+#include "CpuFeatures.hh"
+
+#include "Kernels.hh"
+
+#if defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64)
+#include <intrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+namespace fbi {
+namespace {
+#if defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64)
+void cpuid(unsigned int leaf, unsigned int regs[4])
+{
+    int r[4];
+    __cpuidex(r, int(leaf), 0);
+    for (int i = 0; i < 4; i++)
+        regs[i] = unsigned(r[i]);
+}
+
+unsigned long long enabledStateComponents()
+{
+    return _xgetbv(0);
+}
+#define FBI_HAVE_CPUID
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+void cpuid(unsigned int leaf, unsigned int regs[4])
+{
+    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+}
+
+unsigned long long enabledStateComponents()
+{
+    unsigned int lo, hi;
+    __asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (static_cast<unsigned long long>(hi) << 32) | lo;
+}
+#define FBI_HAVE_CPUID
+#endif
+
+CpuFeatures detectCpuFeatures()
+{
+    CpuFeatures f{};
+#ifdef FBI_HAVE_CPUID
+    unsigned int regs[4];
+    cpuid(0, regs);
+    unsigned int maxLeaf = regs[0];
+    if (maxLeaf < 7)
+        return f;
+    // Leaf 1, ecx bit 27: the OS has enabled xgetbv.
+    cpuid(1, regs);
+    unsigned long long state = ((regs[2] >> 27) & 1) ? enabledStateComponents() : 0;
+    // SSE and AVX state, and in addition the three AVX-512 state components.
+    bool avxState = (state & 0x6) == 0x6, avx512State = (state & 0xe6) == 0xe6;
+    // Structured extended feature flags: leaf 7, subleaf 0, register ebx.
+    cpuid(7, regs);
+    unsigned int ebx = regs[1], ecx = regs[2];
+    f.bmi2 = (ebx >> 8) & 1;
+    f.adx = (ebx >> 19) & 1;
+    f.avx2 = avxState && ((ebx >> 5) & 1);
+    f.avx512f = avx512State && ((ebx >> 16) & 1);
+    f.avx512ifma = f.avx512f && ((ebx >> 21) & 1);
+    f.avx512vpopcntdq = f.avx512f && ((ecx >> 14) & 1);
+#endif
+    return f;
+}
+} // namespace
+
+const CpuFeatures& cpuFeatures()
+{
+    static const CpuFeatures features = detectCpuFeatures();
+    return features;
+}
+
+const char* multiplyKernelName()
+{
+    return detail::multiplyKernels().name;
+}
+} // namespace fbi
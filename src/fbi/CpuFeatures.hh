@@ -0,0 +1,29 @@
+#pragma once
+
+namespace fbi {
+/* The instruction set extensions of the running processor that the library
+ * has kernels for.  They are detected with cpuid once, on first use; on
+ * other architectures every flag is false and the portable kernels run. */
+struct CpuFeatures {
+    // mulx: 64 x 64 -> 128 bit multiplication that leaves the flags alone.
+    bool bmi2;
+    // adcx and adox: additions that carry through CF and OF only.
+    bool adx;
+    /* 256- and 512-bit vector instructions, only set if the operating system
+     * also saves the vector registers. */
+    bool avx2;
+    bool avx512f;
+    // vpmadd52luq and vpmadd52huq: 52-bit multiply-accumulate on 512-bit vectors.
+    bool avx512ifma;
+    // vpopcntq: per-block population count on 512-bit vectors.
+    bool avx512vpopcntdq;
+};
+
+const CpuFeatures& cpuFeatures();
+
+/* Returns the name of the multiply-accumulate kernels in use, which run the
+ * multiplication, squaring and Montgomery arithmetic: "avx512-ifma" for the
+ * 52-bit vector kernels, "bmi2-adx" for the mulx/adcx/adox kernels and
+ * "generic" for the portable ones. */
+const char* multiplyKernelName();
+} // namespace fbi
@@ -0,0 +1,90 @@
+#include "FixedBaseExp.hh"
+
+namespace fbi {
+namespace {
+/* Returns the number of teeth for exponents of the given length.  The table
+ * is built only once, so wider combs pay off sooner than wider sliding
+ * windows do; the cap keeps the table at 256 entries. */
+unsigned int combTeeth(FixedBaseExp::Index exponentBits)
+{
+    if (exponentBits > 256)
+        return 8;
+    if (exponentBits > 64)
+        return 6;
+    if (exponentBits > 16)
+        return 4;
+    return 2;
+}
+
+/* Returns modulus if it is odd, and otherwise throws the MathError the
+ * constructor promises, before base % modulus can divide by zero. */
+const BigUnsigned& oddModulus(const BigUnsigned& modulus)
+{
+    if (!modulus.getBit(0))
+        throw MathError{ "FixedBaseExp::FixedBaseExp", "Modulus must be odd" };
+    return modulus;
+}
+} // namespace
+
+FixedBaseExp::FixedBaseExp(const BigInteger& base, const BigUnsigned& modulus, Index maxExponentBits)
+    : context(oddModulus(modulus)), base((base % modulus).getMagnitude()), teeth(combTeeth(maxExponentBits))
+{
+    columns = (maxExponentBits + teeth - 1) / teeth;
+    if (columns == 0)
+        columns = 1;
+    Index k = context.getLength();
+    Index entries = Index(1) << teeth;
+    table.resize(entries * k);
+    std::vector<Blk> t(2 * k);
+
+    context.load(table.data(), 1);
+    // Entry 2^i is base^(2^(i columns)), one row of `columns' squarings above entry 2^(i - 1).
+    context.load(table.data() + k, this->base);
+    for (unsigned int i = 1; i < teeth; i++) {
+        Blk* row = table.data() + (Index(1) << i) * k;
+        const Blk* prev = table.data() + (Index(1) << (i - 1)) * k;
+        context.multiplyBlocks(row, prev, prev, t.data());
+        for (Index c = 1; c < columns; c++)
+            context.multiplyBlocks(row, row, row, t.data());
+    }
+    // Every other entry is its highest row times the entry for the remaining rows.
+    for (unsigned int i = 1; i < teeth; i++) {
+        Index high = Index(1) << i;
+        for (Index j = 1; j < high; j++)
+            context.multiplyBlocks(table.data() + (high + j) * k, table.data() + high * k, table.data() + j * k,
+                                   t.data());
+    }
+}
+
+const BigUnsigned& FixedBaseExp::getBase() const
+{
+    return base;
+}
+
+const BigUnsigned& FixedBaseExp::getModulus() const
+{
+    return context.getModulus();
+}
+
+FixedBaseExp::Index FixedBaseExp::getMaxExponentBits() const
+{
+    return teeth * columns;
+}
+
+BigUnsigned FixedBaseExp::exp(const BigUnsigned& exponent) const
+{
+    if (exponent.bitLength() > getMaxExponentBits())
+        return context.exp(base, exponent);
+    Index k = context.getLength();
+    std::vector<Blk> acc(table.begin(), table.begin() + k), t(2 * k);
+    for (Index c = columns; c > 0; c--) {
+        context.multiplyBlocks(acc.data(), acc.data(), acc.data(), t.data());
+        Index j = 0;
+        for (unsigned int i = teeth; i > 0; i--)
+            j = (j << 1) | Index(exponent.getBit((i - 1) * columns + c - 1));
+        if (j != 0)
+            context.multiplyBlocks(acc.data(), acc.data(), table.data() + j * k, t.data());
+    }
+    return context.store(acc.data());
+}
+} // namespace fbi
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+
+#include "BigInteger.hh"
+#include "MontgomeryContext.hh"
+
+namespace fbi {
+/* A FixedBaseExp raises one fixed base to many different exponents modulo a
+ * fixed odd modulus, using a precomputed Lim-Lee comb.
+ *
+ * An exponent of up to t c bits is viewed as a t-row, c-column bit matrix:
+ * row i holds bits [i c, (i + 1) c).  For every t-bit pattern j the table
+ * stores the product of base^(2^(i c)) over the rows i set in j, so each
+ * column of the exponent costs one squaring and at most one table
+ * multiplication.  Compared with a plain exponentiation this cuts the
+ * number of squarings by the factor t, the number of ``teeth'' of the comb.
+ *
+ * The table is built once by the constructor and never modified afterwards,
+ * so one FixedBaseExp can be shared by any number of threads. */
+class FixedBaseExp {
+public:
+    typedef BigUnsigned::Blk Blk;
+    typedef BigUnsigned::Index Index;
+
+    /* Precomputes the comb for exponents of up to maxExponentBits bits.
+     * Throws a MathError if the modulus is even or zero. */
+    FixedBaseExp(const BigInteger& base, const BigUnsigned& modulus, Index maxExponentBits);
+
+    const BigUnsigned& getBase() const;
+    const BigUnsigned& getModulus() const;
+    // The longest exponent the comb covers; longer ones are still accepted.
+    Index getMaxExponentBits() const;
+
+    /* Returns (base ^ exponent) % modulus.  Exponents longer than
+     * getMaxExponentBits() fall back to an ordinary sliding window
+     * exponentiation. */
+    BigUnsigned exp(const BigUnsigned& exponent) const;
+
+protected:
+    MontgomeryContext context;
+    // The base, reduced modulo the modulus.
+    BigUnsigned base;
+    // The comb has `teeth' rows of `columns' bits each.
+    unsigned int teeth;
+    Index columns;
+    /* 2^teeth Montgomery-form entries of context.getLength() blocks; entry j
+     * is the product of base^(2^(i columns)) over the bits i set in j. */
+    std::vector<Blk> table;
+};
+} // namespace fbi
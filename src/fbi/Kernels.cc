@@ -0,0 +1,222 @@
+#include "Kernels.hh"
+
+#include "BlockArithmetic.hh"
+#include "CpuFeatures.hh"
+
+namespace fbi {
+namespace detail {
+namespace {
+/* Returns the low block of x * m + r + carry and leaves the high block in
+ * carry.  The sum is below 2^(2N), so it can't overflow. */
+inline Blk mulAddBlock(Blk x, Blk m, Blk r, Blk& carry)
+{
+    Blk hi;
+    Blk lo = mulBlocks(x, m, hi);
+    lo += carry;
+    hi += (lo < carry);
+    lo += r;
+    hi += (lo < r);
+    carry = hi;
+    return lo;
+}
+} // namespace
+
+Blk addMulRowGeneric(Blk* r, const Blk* x, Index n, Blk m)
+{
+    Blk carry = 0;
+    for (Index i = 0; i < n; i++)
+        r[i] = mulAddBlock(x[i], m, r[i], carry);
+    return carry;
+}
+
+#ifdef FBI_X86_64_KERNELS
+/* With mulx, adcx and adox each block's product is added in with two
+ * independent carry chains: adcx adds the high block of the previous product
+ * through CF, adox adds r[i] through OF, and mulx touches neither flag.  The
+ * loop runs four blocks per iteration from a negative index up to zero, as
+ * lea and jrcxz leave both flags alone where inc or dec would clobber OF.  At
+ * the end both chains are folded into the last high block, which can't
+ * overflow since the whole sum fits in n + 1 blocks. */
+#define FBI_MULX_STEP(i, hiIn, hiOut)                        \
+    "mulxq " #i "(%[x],%[j],8), %[lo], %[" #hiOut "]\n\t"    \
+    "adcxq %[" #hiIn "], %[lo]\n\t"                          \
+    "adoxq " #i "(%[r],%[j],8), %[lo]\n\t"                   \
+    "movq %[lo], " #i "(%[r],%[j],8)\n\t"
+
+Blk addMulRowAdx(Blk* r, const Blk* x, Index n, Blk m)
+{
+    Blk carry = 0;
+    Index i = 0;
+    if (Index groups = n / 4) {
+        i = 4 * groups;
+        long long j = -(long long)i;
+        Blk lo, h0;
+        __asm__("xorl %k[lo], %k[lo]\n"
+                "1:\n\t"
+                FBI_MULX_STEP(0, h1, h0)
+                FBI_MULX_STEP(8, h0, h1)
+                FBI_MULX_STEP(16, h1, h0)
+                FBI_MULX_STEP(24, h0, h1)
+                "leaq 4(%[j]), %[j]\n\t"
+                "jrcxz 2f\n\t"
+                "jmp 1b\n"
+                "2:\n\t"
+                "movl $0, %k[lo]\n\t"
+                "adcxq %[lo], %[h1]\n\t"
+                "adoxq %[lo], %[h1]"
+                : [j] "+c"(j), [lo] "=&r"(lo), [h0] "=&r"(h0), [h1] "+r"(carry)
+                : [x] "r"(x + i), [r] "r"(r + i), "d"(m)
+                : "cc", "memory");
+    }
+    for (; i < n; i++)
+        r[i] = mulAddBlock(x[i], m, r[i], carry);
+    return carry;
+}
+#undef FBI_MULX_STEP
+#endif
+
+namespace {
+
+typedef Blk (*RowKernel)(Blk* r, const Blk* x, Index n, Blk m);
+
+// Knuth's Algorithm M, one row per block of a.
+template <RowKernel addMulRow>
+void multiplyRows(Blk* r, const Blk* a, Index an, const Blk* b, Index bn)
+{
+    for (Index i = 0; i < bn; i++)
+        r[i] = 0;
+    for (Index i = 0; i < an; i++)
+        r[i + bn] = addMulRow(r + i, b, bn, a[i]);
+}
+
+/* Squaring needs only half the block products of a multiplication: each
+ * a[i] a[j] with i < j is computed once into the upper triangle, which is then
+ * doubled and has the squares a[i]^2 on the diagonal added in. */
+template <RowKernel addMulRow>
+void squareRows(Blk* r, const Blk* a, Index n)
+{
+    for (Index i = 0; i < 2 * n; i++)
+        r[i] = 0;
+    for (Index i = 0; i + 1 < n; i++)
+        r[i + n] = addMulRow(r + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+    // r = 2 r + the diagonal, two blocks at a time.
+    Blk top = 0, carry = 0;
+    for (Index i = 0; i < n; i++) {
+        Blk hi;
+        Blk lo = mulBlocks(a[i], a[i], hi);
+        Blk r0 = r[2 * i], r1 = r[2 * i + 1];
+        r[2 * i] = addCarry((r0 << 1) | top, lo, carry);
+        r[2 * i + 1] = addCarry((r1 << 1) | (r0 >> (BigUnsigned::N - 1)), hi, carry);
+        top = r1 >> (BigUnsigned::N - 1);
+    }
+}
+
+/* Below this many blocks, calls and loop setup outweigh the row kernels, and
+ * Montgomery multiplication runs the ``coarsely integrated operand scanning''
+ * (CIOS) loop in line instead: for each block a[i], the accumulator u gets
+ * a[i] * b added, and then the multiple m * n of the modulus that clears its
+ * lowest block, which is then dropped. */
+const Index smallMontgomeryBlocks = 8;
+
+Blk montgomerySmall(Blk* t, const Blk* a, const Blk* b, const Blk* n, Blk nInv, Index k)
+{
+    Blk u[smallMontgomeryBlocks + 1] = {};
+    for (Index i = 0; i < k; i++) {
+        Blk carry = 0, top = 0;
+        for (Index j = 0; j < k; j++)
+            u[j] = mulAddBlock(b[j], a[i], u[j], carry);
+        u[k] = addCarry(u[k], carry, top);
+        Blk m = u[0] * nInv;
+        carry = 0;
+        mulAddBlock(n[0], m, u[0], carry);
+        for (Index j = 1; j < k; j++)
+            u[j - 1] = mulAddBlock(n[j], m, u[j], carry);
+        Blk high = 0;
+        u[k - 1] = addCarry(u[k], carry, high);
+        u[k] = top + high;
+    }
+    for (Index i = 0; i < k; i++)
+        t[k + i] = u[i];
+    return u[k];
+}
+
+/* Montgomery multiplication, ``separated operand scanning'' (SOS) variant.
+ * The full product t = a b is formed first, as a square when a and b are the
+ * same array.  Then for each block i the multiple m * n B^i of the modulus
+ * that clears t[i] is added, which leaves a b R^(-1) (mod n) in the upper
+ * half of t. */
+template <RowKernel addMulRow>
+Blk montgomeryRows(Blk* t, const Blk* a, const Blk* b, const Blk* n, Blk nInv, Index k)
+{
+    if (k <= smallMontgomeryBlocks)
+        return montgomerySmall(t, a, b, n, nInv, k);
+    if (a == b)
+        squareRows<addMulRow>(t, a, k);
+    else
+        multiplyRows<addMulRow>(t, a, k, b, k);
+    // The carry out of t[i + k], which the next round adds to t[i + k + 1].
+    Blk extra = 0;
+    for (Index i = 0; i < k; i++) {
+        Blk carry = addMulRow(t + i, n, k, t[i] * nInv);
+        t[i + k] = addCarry(t[i + k], carry, extra);
+    }
+    return extra;
+}
+
+std::vector<const MultiplyKernels*> supportedKernels()
+{
+    std::vector<const MultiplyKernels*> k{ &genericKernels, &radix52Kernels };
+#ifdef FBI_X86_64_KERNELS
+    const CpuFeatures& f = cpuFeatures();
+    if (f.bmi2 && f.adx)
+        k.push_back(&adxKernels);
+    if (f.bmi2 && f.adx && f.avx512f && f.avx512ifma)
+        k.push_back(&ifmaKernels);
+#endif
+    return k;
+}
+
+/* The last supported family is the fastest, except for the portable radix-52
+ * model, which is only there for testing. */
+const MultiplyKernels*& activeKernels()
+{
+    static const MultiplyKernels* active = availableMultiplyKernels().size() > 2
+                                               ? availableMultiplyKernels().back()
+                                               : &genericKernels;
+    return active;
+}
+} // namespace
+
+const MultiplyKernels genericKernels = { "generic",
+                                         addMulRowGeneric,
+                                         multiplyRows<addMulRowGeneric>,
+                                         squareRows<addMulRowGeneric>,
+                                         32,
+                                         montgomeryRows<addMulRowGeneric> };
+
+#ifdef FBI_X86_64_KERNELS
+const MultiplyKernels adxKernels = { "bmi2-adx",
+                                     addMulRowAdx,
+                                     multiplyRows<addMulRowAdx>,
+                                     squareRows<addMulRowAdx>,
+                                     32,
+                                     montgomeryRows<addMulRowAdx> };
+#endif
+
+const MultiplyKernels& multiplyKernels()
+{
+    return *activeKernels();
+}
+
+const std::vector<const MultiplyKernels*>& availableMultiplyKernels()
+{
+    static const std::vector<const MultiplyKernels*> kernels = supportedKernels();
+    return kernels;
+}
+
+void selectMultiplyKernels(const MultiplyKernels& kernels)
+{
+    activeKernels() = &kernels;
+}
+} // namespace detail
+} // namespace fbi
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vector>
+
+#include "BigUnsigned.hh"
+
+// The x86-64 kernel families need GCC- or Clang-style inline assembly and
+// target attributes.
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define FBI_X86_64_KERNELS
+#endif
+
+namespace fbi {
+namespace detail {
+/* RUNTIME KERNEL DISPATCH
+ * The innermost loops of multiplication come in families, one per
+ * instruction set.  The best family the processor supports is picked once,
+ * on first use, from the flags in cpuFeatures(); the portable "generic"
+ * family runs everywhere.  Callers in loops should copy the function
+ * pointers out of multiplyKernels() rather than look them up each time.
+ *
+ * Every kernel's running time depends only on the lengths of its operands,
+ * never on their values. */
+
+typedef BigUnsigned::Blk Blk;
+typedef BigUnsigned::Index Index;
+
+struct MultiplyKernels {
+    const char* name;
+    /* r[0..n) += x[0..n) * m; returns the block carried out of the top.  r
+     * may alias x. */
+    Blk (*addMulRow)(Blk* r, const Blk* x, Index n, Blk m);
+    /* r[0..an+bn) = a[0..an) * b[0..bn), and r[0..2n) = a[0..n)^2, by the
+     * family's basecase method.  r must not overlap the operands. */
+    void (*multiply)(Blk* r, const Blk* a, Index an, const Blk* b, Index bn);
+    void (*square)(Blk* r, const Blk* a, Index n);
+    // Operands this long or longer are split by Karatsuba's method first.
+    Index karatsubaThreshold;
+    /* Montgomery multiplication: for a, b < n of k blocks, n odd and
+     * nInv = -n^(-1) mod 2^N, leaves some x < 2n with
+     * x == a b 2^(-N k) (mod n) in t[k..2k) and returns its block k, which is
+     * 0 or 1.  t[0..2k) is scratch.  a may be the same array as b. */
+    Blk (*montgomeryMultiply)(Blk* t, const Blk* a, const Blk* b, const Blk* n, Blk nInv, Index k);
+};
+
+const MultiplyKernels& multiplyKernels();
+
+/* Every family the running processor supports, generic first.  Tests and
+ * benchmarks run through them all with selectMultiplyKernels, which is not
+ * thread-safe and must not be called while other threads do arithmetic. */
+const std::vector<const MultiplyKernels*>& availableMultiplyKernels();
+void selectMultiplyKernels(const MultiplyKernels& kernels);
+
+/* The families.  "radix52" is the portable model of "avx512-ifma": the same
+ * algorithms on 52-bit limbs, one limb at a time.  It is never picked by
+ * default, but it lets the tests check the radix-52 arithmetic on processors
+ * without IFMA. */
+extern const MultiplyKernels genericKernels;
+extern const MultiplyKernels radix52Kernels;
+#ifdef FBI_X86_64_KERNELS
+extern const MultiplyKernels adxKernels;
+extern const MultiplyKernels ifmaKernels;
+#endif
+
+/* The blockwise kernels, which run the bitwise operators, comparisons and
+ * shifts over whole arrays, come in families chosen the same way.  Unlike
+ * the multiplication kernels, highestDifference stops at the first
+ * difference it finds. */
+struct BitwiseKernels {
+    const char* name;
+    /* r[0..n) = a[0..n) op b[0..n).  r may be the same array as a or b, but
+     * must not overlap them otherwise. */
+    void (*andBlocks)(Blk* r, const Blk* a, const Blk* b, Index n);
+    void (*orBlocks)(Blk* r, const Blk* a, const Blk* b, Index n);
+    void (*xorBlocks)(Blk* r, const Blk* a, const Blk* b, Index n);
+    /* Returns one more than the index of the most significant block in which
+     * a[0..n) and b[0..n) differ, or 0 if they are equal. */
+    Index (*highestDifference)(const Blk* a, const Blk* b, Index n);
+    /* Shift x[0..n) by 0 < s < N bits into r[0..n), for n > 0.  shiftLeft
+     * returns the bits shifted out of the top; it works from the top down, so
+     * r may overlap x if r >= x.  shiftRight works from the bottom up, so r
+     * may overlap x if r <= x. */
+    Blk (*shiftLeft)(Blk* r, const Blk* x, Index n, unsigned int s);
+    void (*shiftRight)(Blk* r, const Blk* x, Index n, unsigned int s);
+    // The number of set bits in a[0..n), and in a[0..n) ^ b[0..n).
+    Index (*popCount)(const Blk* a, Index n);
+    Index (*hammingDistance)(const Blk* a, const Blk* b, Index n);
+};
+
+const BitwiseKernels& bitwiseKernels();
+const std::vector<const BitwiseKernels*>& availableBitwiseKernels();
+void selectBitwiseKernels(const BitwiseKernels& kernels);
+
+extern const BitwiseKernels genericBitwiseKernels;
+#ifdef FBI_X86_64_KERNELS
+extern const BitwiseKernels sse2BitwiseKernels;
+extern const BitwiseKernels avx2BitwiseKernels;
+extern const BitwiseKernels avx512BitwiseKernels;
+extern const BitwiseKernels vpopcntdqBitwiseKernels;
+#endif
+
+// The row kernels, which the radix-52 families share.
+Blk addMulRowGeneric(Blk* r, const Blk* x, Index n, Blk m);
+#ifdef FBI_X86_64_KERNELS
+Blk addMulRowAdx(Blk* r, const Blk* x, Index n, Blk m);
+#endif
+} // namespace detail
+} // namespace fbi
@@ -0,0 +1,188 @@
+#include "MontgomeryContext.hh"
+
+#include <algorithm>
+
+#include "BlockArithmetic.hh"
+#include "Kernels.hh"
+
+namespace fbi {
+namespace {
+typedef BigUnsigned::Blk Blk;
+typedef BigUnsigned::Index Index;
+
+// Copies x into r[0..k), padding with zero blocks.
+void copyPadded(Blk* r, const BigUnsigned& x, Index k)
+{
+    for (Index i = 0; i < k; i++)
+        r[i] = x.getBlock(i);
+}
+} // namespace
+
+namespace detail {
+unsigned int slidingWindowBits(Index exponentBits, Index& cost)
+{
+    unsigned int best = 1;
+    cost = exponentBits / 2;
+    for (unsigned int w = 2; w < 8; w++) {
+        Index c = (Index(1) << (w - 1)) + exponentBits / (w + 1);
+        if (c < cost) {
+            cost = c;
+            best = w;
+        }
+    }
+    return best;
+}
+
+std::vector<ExponentWindow> slidingWindows(const BigUnsigned& exponent, unsigned int w)
+{
+    std::vector<ExponentWindow> windows;
+    Index i = exponent.bitLength();
+    while (i > 0) {
+        if (!exponent.getBit(i - 1)) {
+            i--;
+            continue;
+        }
+        Index j = (i > w) ? i - w : 0;
+        while (!exponent.getBit(j))
+            j++;
+        ExponentWindow window = { j, 0 };
+        for (Index b = i; b > j; b--)
+            window.value = (window.value << 1) | Index(exponent.getBit(b - 1));
+        windows.push_back(window);
+        i = j;
+    }
+    return windows;
+}
+} // namespace detail
+
+MontgomeryContext::MontgomeryContext(const BigUnsigned& modulus) : modulus(modulus)
+{
+    if (!modulus.getBit(0))
+        throw MathError{ "MontgomeryContext::MontgomeryContext", "Modulus must be odd" };
+    Index k = modulus.getLength();
+    n.resize(k);
+    copyPadded(n.data(), modulus, k);
+
+    nInv = Blk(0) - detail::inverseBlock(n[0]);
+
+    BigUnsigned r2 = BigUnsigned(1) << int(2 * BigUnsigned::N * k);
+    r2 %= modulus;
+    rSquared.resize(k);
+    copyPadded(rSquared.data(), r2, k);
+}
+
+const BigUnsigned& MontgomeryContext::getModulus() const
+{
+    return modulus;
+}
+
+MontgomeryContext::Index MontgomeryContext::getLength() const
+{
+    return Index(n.size());
+}
+
+/*
+ * The Montgomery product itself comes from the multiplication kernels (see
+ * Kernels.hh); all of them take time depending only on k.  It is less than
+ * 2n, so a single conditional subtraction finishes the reduction.
+ */
+void MontgomeryContext::multiplyBlocks(Blk* r, const Blk* a, const Blk* b, Blk* t) const
+{
+    Index k = getLength();
+    Blk extra = detail::multiplyKernels().montgomeryMultiply(t, a, b, n.data(), nInv, k);
+    t += k;
+    /* Subtract n if t >= n, i.e. if extra is set or t - n does not borrow.
+     * Both candidates are computed and selected with a mask, so the time
+     * taken does not depend on the operands. */
+    Blk borrow = detail::subtractBlocks(r, t, n.data(), k);
+    Blk keep = detail::maskIf((extra == 0) & (borrow != 0));
+    for (Index i = 0; i < k; i++)
+        r[i] = (t[i] & keep) | (r[i] & ~keep);
+}
+
+void MontgomeryContext::load(Blk* r, const BigUnsigned& x) const
+{
+    Index k = getLength();
+    std::vector<Blk> xr(k), t(2 * k);
+    if (x < modulus)
+        copyPadded(xr.data(), x, k);
+    else
+        copyPadded(xr.data(), x % modulus, k);
+    multiplyBlocks(r, xr.data(), rSquared.data(), t.data());
+}
+
+BigUnsigned MontgomeryContext::store(const Blk* a) const
+{
+    Index k = getLength();
+    std::vector<Blk> unit(k, 0), r(k), t(2 * k);
+    unit[0] = 1;
+    multiplyBlocks(r.data(), a, unit.data(), t.data());
+    return BigUnsigned{ r.data(), k };
+}
+
+BigUnsigned MontgomeryContext::toMontgomery(const BigUnsigned& x) const
+{
+    std::vector<Blk> r(getLength());
+    load(r.data(), x);
+    return BigUnsigned{ r.data(), getLength() };
+}
+
+BigUnsigned MontgomeryContext::fromMontgomery(const BigUnsigned& x) const
+{
+    std::vector<Blk> a(getLength());
+    copyPadded(a.data(), x, getLength());
+    return store(a.data());
+}
+
+BigUnsigned MontgomeryContext::one() const
+{
+    return toMontgomery(1);
+}
+
+BigUnsigned MontgomeryContext::multiply(const BigUnsigned& a, const BigUnsigned& b) const
+{
+    Index k = getLength();
+    std::vector<Blk> ab(2 * k), t(2 * k);
+    copyPadded(ab.data(), a, k);
+    copyPadded(ab.data() + k, b, k);
+    multiplyBlocks(ab.data(), ab.data(), ab.data() + k, t.data());
+    return BigUnsigned{ ab.data(), k };
+}
+
+/*
+ * Left-to-right sliding window exponentiation.  The table holds the odd
+ * powers base^1, base^3, ..., base^(2^w - 1).  Each run of up to w exponent
+ * bits that starts and ends with a 1 costs one table multiplication; zero
+ * bits between runs cost only squarings.
+ */
+BigUnsigned MontgomeryContext::exp(const BigUnsigned& base, const BigUnsigned& exponent) const
+{
+    Index k = getLength();
+    Index bits = exponent.bitLength();
+    if (bits == 0)
+        return BigUnsigned(1) % modulus;
+    Index cost;
+    unsigned int w = detail::slidingWindowBits(bits, cost);
+    Index tableSize = Index(1) << (w - 1);
+
+    std::vector<Blk> table(tableSize * k), acc(k), t(2 * k);
+    load(table.data(), base);
+    // acc = base^2, then table[i] = table[i - 1] * base^2.
+    multiplyBlocks(acc.data(), table.data(), table.data(), t.data());
+    for (Index i = 1; i < tableSize; i++)
+        multiplyBlocks(table.data() + i * k, table.data() + (i - 1) * k, acc.data(), t.data());
+
+    // Squarings carry each window down to the position of the next one.
+    std::vector<detail::ExponentWindow> windows = detail::slidingWindows(exponent, w);
+    const Blk* first = table.data() + (windows[0].value >> 1) * k;
+    std::copy(first, first + k, acc.begin());
+    for (std::size_t i = 1; i <= windows.size(); i++) {
+        Index position = (i < windows.size()) ? windows[i].position : 0;
+        for (Index b = position; b < windows[i - 1].position; b++)
+            multiplyBlocks(acc.data(), acc.data(), acc.data(), t.data());
+        if (i < windows.size())
+            multiplyBlocks(acc.data(), acc.data(), table.data() + (windows[i].value >> 1) * k, t.data());
+    }
+    return store(acc.data());
+}
+} // namespace fbi
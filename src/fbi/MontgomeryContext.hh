@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vector>
+
+#include "BigUnsigned.hh"
+#include "Exception.hh"
+
+namespace fbi {
+/* A MontgomeryContext holds the precomputed values for Montgomery arithmetic
+ * modulo a fixed odd modulus n.
+ *
+ * With R = 2^(N * k), where k is the number of blocks of n, a number x is
+ * represented in ``Montgomery form'' by x R mod n.  The Montgomery product of
+ * two such numbers, a b R^(-1) mod n, is again in Montgomery form and is
+ * computed with multiplications and shifts only: no division by n is ever
+ * needed.  This makes long chains of modular multiplications, such as
+ * exponentiations, much cheaper than reducing with `divideWithRemainder'
+ * after every step.
+ *
+ * A context is immutable once constructed, so one context can be shared by
+ * any number of threads. */
+class MontgomeryContext {
+public:
+    typedef BigUnsigned::Blk Blk;
+    typedef BigUnsigned::Index Index;
+
+    // Throws a MathError if the modulus is even or zero.
+    explicit MontgomeryContext(const BigUnsigned& modulus);
+
+    const BigUnsigned& getModulus() const;
+
+    // The number of blocks of the modulus, and of every Montgomery-form value.
+    Index getLength() const;
+
+    // Returns x R mod n.
+    BigUnsigned toMontgomery(const BigUnsigned& x) const;
+    // Returns x R^(-1) mod n, which undoes toMontgomery for x < n.
+    BigUnsigned fromMontgomery(const BigUnsigned& x) const;
+    // Returns the Montgomery form of 1, i.e. R mod n.
+    BigUnsigned one() const;
+
+    // Returns the Montgomery product a b R^(-1) mod n of a, b < n.
+    BigUnsigned multiply(const BigUnsigned& a, const BigUnsigned& b) const;
+
+    /* Returns (base ^ exponent) % n.  The base and result are ordinary
+     * numbers, not Montgomery forms; the base need not be reduced. */
+    BigUnsigned exp(const BigUnsigned& base, const BigUnsigned& exponent) const;
+
+    /* LOW-LEVEL INTERFACE
+     * Library code that runs long chains of Montgomery operations works on
+     * fixed-length arrays of getLength() blocks instead of BigUnsigneds. */
+
+    /* r = a b R^(-1) mod n.  r may alias a or b.  scratch must hold
+     * 2 * getLength() blocks.  The running time depends only on getLength(),
+     * never on the values of a and b. */
+    void multiplyBlocks(Blk* r, const Blk* a, const Blk* b, Blk* scratch) const;
+
+    // Loads x mod n in Montgomery form into r.
+    void load(Blk* r, const BigUnsigned& x) const;
+    // Converts the Montgomery form a back to an ordinary number.
+    BigUnsigned store(const Blk* a) const;
+
+protected:
+    // The modulus, also as a block array of length k.
+    BigUnsigned modulus;
+    std::vector<Blk> n;
+    // -n^(-1) mod 2^N
+    Blk nInv;
+    // R^2 mod n; a Montgomery product with it converts into Montgomery form.
+    std::vector<Blk> rSquared;
+};
+
+namespace detail {
+/* A window of a sliding window decomposition: the exponent contains
+ * value * 2^position, with value odd. */
+struct ExponentWindow {
+    BigUnsigned::Index position;
+    BigUnsigned::Index value;
+};
+
+/* Returns the sliding window width for an exponent of the given length and
+ * stores its cost in multiplications, not counting the squarings: a table of
+ * 2^(w - 1) odd powers plus about one multiplication per w + 1 bits.  Every
+ * sliding window exponentiation in the library picks its width here. */
+unsigned int slidingWindowBits(BigUnsigned::Index exponentBits, BigUnsigned::Index& cost);
+
+// Decomposes the exponent into odd windows of at most w bits, most significant first.
+std::vector<ExponentWindow> slidingWindows(const BigUnsigned& exponent, unsigned int w);
+} // namespace detail
+} // namespace fbi
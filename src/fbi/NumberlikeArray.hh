@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+
 namespace fbi {
 /* A NumberlikeArray<Blk> object holds a heap-allocated array of Blk with a
  * length and a capacity and provides basic memory management features.
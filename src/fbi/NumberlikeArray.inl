@@ -1,5 +1,11 @@
 /* BEGIN TEMPLATE DEFINITIONS.  They are present here so that source files that
- * include this header file can generate the necessary real definitions. */
+ * include this header file can generate the necessary real definitions.
+ *
+ * The blocks are copied and compared with std::copy and std::equal, which for
+ * the integer block types become memmove and memcmp: the C library picks
+ * vector versions of those for the running processor itself.  Empty arrays may
+ * have a null blk, which those must not be given even for a length of 0, so
+ * empty copies are skipped. */
 
 template <class Blk>
 const unsigned int NumberlikeArray<Blk>::N = 8 * sizeof(Blk);
@@ -45,9 +51,8 @@ void NumberlikeArray<Blk>::allocateAndCopy(Index c)
         cap = c;
         blk = new Blk[cap];
         // Copy number blocks
-        Index i;
-        for (i = 0; i < len; i++)
-            blk[i] = oldBlk[i];
+        if (len > 0)
+            std::copy(oldBlk, oldBlk + len, blk);
         // Delete the old array
         delete[] oldBlk;
     }
@@ -60,9 +65,8 @@ NumberlikeArray<Blk>::NumberlikeArray(const NumberlikeArray<Blk>& x) : len(x.len
     cap = len;
     blk = new Blk[cap];
     // Copy blocks
-    Index i;
-    for (i = 0; i < len; i++)
-        blk[i] = x.blk[i];
+    if (len > 0)
+        std::copy(x.blk, x.blk + len, blk);
 }
 
 template <class Blk>
@@ -77,9 +81,8 @@ NumberlikeArray<Blk>& NumberlikeArray<Blk>::operator=(const NumberlikeArray<Blk>
     // Expand array if necessary
     allocate(len);
     // Copy number blocks
-    Index i;
-    for (i = 0; i < len; i++)
-        blk[i] = x.blk[i];
+    if (len > 0)
+        std::copy(x.blk, x.blk + len, blk);
 
     return *this;
 }
@@ -90,9 +93,8 @@ NumberlikeArray<Blk>::NumberlikeArray(const Blk* b, Index blen) : cap(blen), len
     // Create array
     blk = new Blk[cap];
     // Copy blocks
-    Index i;
-    for (i = 0; i < len; i++)
-        blk[i] = b[i];
+    if (len > 0)
+        std::copy(b, b + len, blk);
 }
 
 template <class Blk>
@@ -125,15 +127,11 @@ bool NumberlikeArray<Blk>::operator==(const NumberlikeArray<Blk>& x) const
     if (len != x.len)
         // Definitely unequal.
         return false;
-    else {
-        // Compare corresponding blocks one by one.
-        Index i;
-        for (i = 0; i < len; i++)
-            if (blk[i] != x.blk[i])
-                return false;
-        // No blocks differed, so the objects are equal.
+    else if (len == 0)
         return true;
-    }
+    else
+        // Compare the blocks all at once.
+        return std::equal(blk, blk + len, x.blk);
 }
 
 template <class Blk>
@@ -0,0 +1,358 @@
+#include "Kernels.hh"
+
+#include <utility>
+
+#include "BlockArithmetic.hh"
+
+#ifdef FBI_X86_64_KERNELS
+#include <immintrin.h>
+#endif
+
+/*
+ * RADIX-52 KERNELS
+ * AVX-512 IFMA multiplies the low 52 bits of eight pairs of 64-bit lanes and
+ * adds either the low or the high 52 bits of each product to a third vector
+ * (vpmadd52luq, vpmadd52huq).  These kernels therefore split their operands
+ * into 52-bit limbs, and as each accumulated half-product is below 2^52, a
+ * 64-bit lane holds the sum of thousands of them: carries are propagated once,
+ * when the result is packed back into blocks, not after every product.
+ *
+ * Each kernel comes twice, vectorized for IFMA and as a portable scalar model
+ * of the same arithmetic, which makes up the "radix52" family.
+ */
+
+namespace fbi {
+namespace detail {
+namespace {
+const unsigned int limbBits = 52;
+const Blk limbMask = (Blk(1) << limbBits) - 1;
+
+/* Products whose shorter operand has at most this many blocks sum fewer than
+ * 2^11 half-products into each column, so that the column sums and the
+ * carries into them fit in a block. */
+const Index maxProductBlocks = 1536;
+/* A Montgomery product of L limbs accumulates at most 4 L half-products in
+ * each limb, which must stay below 2^12. */
+const Index maxMontgomeryLimbs = 1000;
+
+// Returns the number of limbs of an n-block number shifted left by s bits.
+Index limbCount(Index n, unsigned int s)
+{
+    return Index((Blk(n) * BigUnsigned::N + s + limbBits - 1) / limbBits);
+}
+
+// Splits x[0..n) << s, with s < limbBits, into the limbs d[0..dn).
+void toLimbs(Blk* d, Index dn, const Blk* x, Index n, unsigned int s)
+{
+    for (Index k = 0; k < dn; k++) {
+        // Bits [p, p + limbBits) of x, where p may be negative.
+        long long p = (long long)k * limbBits - s;
+        Blk v;
+        if (p < 0)
+            v = x[0] << -p;
+        else {
+            Index q = Index(p / BigUnsigned::N);
+            unsigned int r = unsigned(p % BigUnsigned::N);
+            v = (q < n) ? x[q] >> r : 0;
+            if (r > BigUnsigned::N - limbBits && q + 1 < n)
+                v |= x[q + 1] << (BigUnsigned::N - r);
+        }
+        d[k] = v & limbMask;
+    }
+}
+
+/* Packs the number with the limbs lo[i] + hi[i - 1] (hi may be null), which
+ * may exceed 52 bits, into r[0..rn).  The caller guarantees that it fits. */
+void fromLimbs(Blk* r, Index rn, const Blk* lo, const Blk* hi, Index ln)
+{
+    Blk carry = 0, acc = 0;
+    unsigned int bits = 0;
+    Index o = 0;
+    for (Index i = 0; o < rn; i++) {
+        Blk v = carry;
+        if (i < ln)
+            v += lo[i];
+        if (hi != nullptr && i > 0 && i <= ln)
+            v += hi[i - 1];
+        carry = v >> limbBits;
+        Blk limb = v & limbMask;
+        acc |= limb << bits;
+        bits += limbBits;
+        if (bits >= BigUnsigned::N) {
+            r[o++] = acc;
+            bits -= BigUnsigned::N;
+            acc = bits ? limb >> (limbBits - bits) : 0;
+        }
+    }
+}
+
+// Returns a per-thread work area of at least n blocks.
+Blk* workspace(Index n)
+{
+    thread_local std::vector<Blk> w;
+    if (w.size() < n)
+        w.resize(n);
+    return w.data();
+}
+
+// The low and high 52 bits of the 104-bit product of two limbs.
+inline Blk mulLo52(Blk x, Blk y)
+{
+    return (x * y) & limbMask;
+}
+
+inline Blk mulHi52(Blk x, Blk y)
+{
+    Blk hi;
+    Blk lo = mulBlocks(x, y, hi);
+    return (hi << (BigUnsigned::N - limbBits)) | (lo >> limbBits);
+}
+
+/* The product as columns: lo[i + j] collects the low and hi[i + j] the high
+ * halves of the limb products A[i] B[j]. */
+void multiplyLimbsPortable(Blk* lo, Blk* hi, const Blk* A, Index la, const Blk* B, Index lb)
+{
+    for (Index i = 0; i < la + lb; i++)
+        lo[i] = hi[i] = 0;
+    for (Index i = 0; i < la; i++)
+        for (Index j = 0; j < lb; j++) {
+            lo[i + j] += mulLo52(A[i], B[j]);
+            hi[i + j] += mulHi52(A[i], B[j]);
+        }
+}
+
+/* Word-by-word Montgomery reduction on limbs: for each limb of A, T gets
+ * A[i] B added, then the multiple m N that clears its lowest limb, and is
+ * shifted down by one limb.  T has L + 1 limbs. */
+void montgomeryLimbsPortable(Blk* T, const Blk* A, const Blk* B, const Blk* N, Blk nInv, Index L)
+{
+    for (Index j = 0; j <= L; j++)
+        T[j] = 0;
+    for (Index i = 0; i < L; i++) {
+        Blk t0 = T[0] + mulLo52(A[i], B[0]);
+        Blk m = (t0 * nInv) & limbMask;
+        t0 += mulLo52(m, N[0]);
+        for (Index j = 0; j < L; j++) {
+            Blk x = T[j + 1] + mulHi52(A[i], B[j]) + mulHi52(m, N[j]);
+            if (j + 1 < L)
+                x += mulLo52(A[i], B[j + 1]) + mulLo52(m, N[j + 1]);
+            T[j] = x;
+        }
+        T[0] += t0 >> limbBits;
+    }
+}
+
+typedef void (*LimbProduct)(Blk* lo, Blk* hi, const Blk* A, Index la, const Blk* B, Index lb);
+
+/* Multiplies through limbs, or with the given fallback family when the
+ * shorter operand is outside [minBlocks, maxProductBlocks].  pad zero limbs
+ * follow each limb operand, and the column arrays have room for pad more. */
+template <LimbProduct product, const MultiplyKernels& fallback, Index minBlocks, Index pad>
+void multiplyLimbs(Blk* r, const Blk* a, Index an, const Blk* b, Index bn)
+{
+    Index shorter = (an < bn) ? an : bn;
+    if (shorter < minBlocks || shorter > maxProductBlocks) {
+        fallback.multiply(r, a, an, b, bn);
+        return;
+    }
+    Index la = limbCount(an, 0), lb = limbCount(bn, 0);
+    Blk* w = workspace(3 * (la + lb) + 6 * pad);
+    Blk *A = w + pad, *B = A + la + pad, *lo = B + lb + pad, *hi = lo + la + lb + pad;
+    for (Index i = 0; i < pad; i++)
+        w[i] = A[la + i] = B[lb + i] = 0;
+    toLimbs(A, la, a, an, 0);
+    toLimbs(B, lb, b, bn, 0);
+    product(lo, hi, A, la, B, lb);
+    fromLimbs(r, an + bn, lo, hi, la + lb);
+}
+
+/* There's no separate squaring on limbs, which would save little next to
+ * the conversions; below minBlocks the fallback family squares. */
+template <LimbProduct product, const MultiplyKernels& fallback, Index minBlocks, Index pad>
+void squareLimbs(Blk* r, const Blk* a, Index n)
+{
+    if (n < minBlocks)
+        fallback.square(r, a, n);
+    else
+        multiplyLimbs<product, fallback, minBlocks, pad>(r, a, n, a, n);
+}
+
+/* With R = 2^(N k) and L limbs, R52 = 2^(52 L) exceeds R by d bits.  The
+ * limbs of A are taken from a 2^d, which still fits, so that the reduction by
+ * R52 comes to a b R^(-1).  The result is below (2^d n^2 + R52 n) / R52 < 2n,
+ * and is packed into k + 1 blocks behind the limbs. */
+typedef void (*LimbMontgomery)(Blk* T, const Blk* A, const Blk* B, const Blk* N, Blk nInv, Index L);
+
+template <LimbMontgomery reduce, const MultiplyKernels& fallback, Index minBlocks, Index maxLimbs, Index pad>
+Blk montgomeryLimbs(Blk* t, const Blk* a, const Blk* b, const Blk* n, Blk nInv, Index k)
+{
+    Index L = limbCount(k, 0);
+    if (k < minBlocks || L > maxLimbs)
+        return fallback.montgomeryMultiply(t, a, b, n, nInv, k);
+    unsigned int d = unsigned(Blk(L) * limbBits - Blk(k) * BigUnsigned::N);
+    Index stride = L + pad + 2;
+    Blk* w = workspace(5 * stride + k + 2);
+    Blk *A = w + 1, *B = A + stride, *M = B + stride, *T = M + stride, *r = T + 2 * stride;
+    for (Index i = 0; i <= pad; i++)
+        A[L + i] = B[L + i] = M[L + i] = 0;
+    A[-1] = B[-1] = M[-1] = 0;
+    toLimbs(A, L, a, k, d);
+    toLimbs(B, L, b, k, 0);
+    toLimbs(M, L, n, k, 0);
+    reduce(T, A, B, M, nInv & limbMask, L);
+    fromLimbs(r, k + 1, T, nullptr, L + 1);
+    for (Index i = 0; i < k; i++)
+        t[k + i] = r[i];
+    return r[k];
+}
+
+#ifdef FBI_X86_64_KERNELS
+#define FBI_IFMA __attribute__((target("avx512f,avx512ifma")))
+
+/* GCC 12 warns that the AVX-512 headers read the undefined vector behind casts
+ * and lane shifts (GCC bug 105593), once per instantiation below. */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+/* The columns of the product sixteen at a time, in four accumulators: for
+ * columns [c, c + 8) and [c + 8, c + 16), the broadcast limb A[i] multiplies
+ * B[c - i..c - i + 8) and B[c + 8 - i..c + 16 - i).  B has 16 zero limbs on
+ * either side, which the windows at the ends run into. */
+FBI_IFMA void multiplyLimbsIfma(Blk* lo, Blk* hi, const Blk* A, Index la, const Blk* B, Index lb)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    for (Index c = 0; c < la + lb; c += 16) {
+        __m512i lo0 = zero, hi0 = zero, lo1 = zero, hi1 = zero;
+        Index first = (c + 1 > lb) ? c + 1 - lb : 0, last = (c + 16 < la) ? c + 16 : la;
+        for (Index i = first; i < last; i++) {
+            __m512i x = _mm512_set1_epi64((long long)A[i]);
+            const Blk* y = B + c - i;
+            __m512i y0 = _mm512_loadu_si512(y), y1 = _mm512_loadu_si512(y + 8);
+            lo0 = _mm512_madd52lo_epu64(lo0, y0, x);
+            hi0 = _mm512_madd52hi_epu64(hi0, y0, x);
+            lo1 = _mm512_madd52lo_epu64(lo1, y1, x);
+            hi1 = _mm512_madd52hi_epu64(hi1, y1, x);
+        }
+        _mm512_storeu_si512(lo + c, lo0);
+        _mm512_storeu_si512(hi + c, hi0);
+        _mm512_storeu_si512(lo + c + 8, lo1);
+        _mm512_storeu_si512(hi + c + 8, hi1);
+    }
+}
+
+FBI_IFMA inline Blk lane(__m512i x, int i)
+{
+    __m128i low = _mm512_castsi512_si128(x);
+    return Blk(i == 0 ? _mm_cvtsi128_si64(low) : _mm_extract_epi64(low, 1));
+}
+
+/*
+ * The word-by-word reduction with T in C vector registers, L + 1 <= 8 C.
+ * The terms of A[i] and of m go to separate accumulators u and w, so that
+ * each takes only two multiply-adds per round, and both add the high halves
+ * of the products one limb up (B[-1] = N[-1] = 0) before the shift rather
+ * than after it.  Limb 0 of T, from which m comes, is kept in a scalar: the
+ * next one is computed from lane 1 of u and w and the m terms in scalar
+ * arithmetic, so the vector lanes 0 are never read back.
+ */
+template <int C>
+FBI_IFMA void montgomeryLimbsIfma(Blk* T, const Blk* A, const Blk* B, const Blk* N, Blk nInv, Index L)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i u[C], w[C], b[C], bUp[C], n[C], nUp[C];
+#pragma GCC unroll 32
+    for (int c = 0; c < C; c++) {
+        u[c] = w[c] = zero;
+        b[c] = _mm512_loadu_si512(B + 8 * c);
+        bUp[c] = _mm512_loadu_si512(B + 8 * c - 1);
+        n[c] = _mm512_loadu_si512(N + 8 * c);
+        nUp[c] = _mm512_loadu_si512(N + 8 * c - 1);
+    }
+    Blk t0 = 0;
+    for (Index i = 0; i < L; i++) {
+        __m512i x = _mm512_set1_epi64((long long)A[i]);
+#pragma GCC unroll 32
+        for (int c = 0; c < C; c++) {
+            u[c] = _mm512_madd52lo_epu64(u[c], b[c], x);
+            u[c] = _mm512_madd52hi_epu64(u[c], bUp[c], x);
+        }
+        t0 += mulLo52(A[i], B[0]);
+        Blk m = (t0 * nInv) & limbMask;
+        __m512i y = _mm512_set1_epi64((long long)m);
+        Blk w1 = lane(w[0], 1);
+#pragma GCC unroll 32
+        for (int c = 0; c < C; c++) {
+            w[c] = _mm512_madd52lo_epu64(w[c], n[c], y);
+            w[c] = _mm512_madd52hi_epu64(w[c], nUp[c], y);
+        }
+        t0 = ((t0 + mulLo52(m, N[0])) >> limbBits) + lane(u[0], 1) + w1 + mulLo52(m, N[1]) + mulHi52(m, N[0]);
+#pragma GCC unroll 32
+        for (int c = 0; c < C - 1; c++) {
+            u[c] = _mm512_alignr_epi64(u[c + 1], u[c], 1);
+            w[c] = _mm512_alignr_epi64(w[c + 1], w[c], 1);
+        }
+        u[C - 1] = _mm512_alignr_epi64(zero, u[C - 1], 1);
+        w[C - 1] = _mm512_alignr_epi64(zero, w[C - 1], 1);
+    }
+#pragma GCC unroll 32
+    for (int c = 0; c < C; c++)
+        _mm512_storeu_si512(T + 8 * c, _mm512_add_epi64(u[c], w[c]));
+    T[0] = t0;
+}
+
+// The instances for C = 1, ..., maxIfmaRegisters, indexed by C - 1.
+const int maxIfmaRegisters = 32;
+const Index maxIfmaMontgomeryLimbs = 8 * maxIfmaRegisters - 1;
+
+template <std::size_t... I>
+struct MontgomeryIfmaTable {
+    static constexpr LimbMontgomery kernels[sizeof...(I)] = { montgomeryLimbsIfma<int(I) + 1>... };
+};
+
+template <std::size_t... I>
+constexpr LimbMontgomery MontgomeryIfmaTable<I...>::kernels[sizeof...(I)];
+
+template <std::size_t... I>
+MontgomeryIfmaTable<I...> montgomeryIfmaTable(std::index_sequence<I...>)
+{
+    return {};
+}
+
+void montgomeryLimbsIfmaAny(Blk* T, const Blk* A, const Blk* B, const Blk* N, Blk nInv, Index L)
+{
+    typedef decltype(montgomeryIfmaTable(std::make_index_sequence<maxIfmaRegisters>())) Table;
+    Table::kernels[L / 8](T, A, B, N, nInv, L);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#undef FBI_IFMA
+#endif
+} // namespace
+
+/* On the IFMA family, products of fewer than about 16 blocks, squares of
+ * fewer than 24 and Montgomery products of fewer than 12 are faster on the
+ * rows of the bmi2-adx family, which runs them instead.  The basecase product
+ * beats Karatsuba's method up to about 128 blocks. */
+const MultiplyKernels radix52Kernels = { "radix52",
+                                         addMulRowGeneric,
+                                         multiplyLimbs<multiplyLimbsPortable, genericKernels, 1, 0>,
+                                         squareLimbs<multiplyLimbsPortable, genericKernels, 1, 0>,
+                                         32,
+                                         montgomeryLimbs<montgomeryLimbsPortable, genericKernels, 1,
+                                                         maxMontgomeryLimbs, 0> };
+
+#ifdef FBI_X86_64_KERNELS
+const MultiplyKernels ifmaKernels = { "avx512-ifma",
+                                      addMulRowAdx,
+                                      multiplyLimbs<multiplyLimbsIfma, adxKernels, 16, 16>,
+                                      squareLimbs<multiplyLimbsIfma, adxKernels, 24, 16>,
+                                      128,
+                                      montgomeryLimbs<montgomeryLimbsIfmaAny, adxKernels, 12,
+                                                      maxIfmaMontgomeryLimbs, 8> };
+#endif
+} // namespace detail
+} // namespace fbi
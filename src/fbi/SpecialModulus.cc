@@ -0,0 +1,234 @@
+#include "SpecialModulus.hh"
+
+#include <vector>
+
+#include "BlockArithmetic.hh"
+#include "Kernels.hh"
+
+namespace fbi {
+namespace {
+typedef BigUnsigned::Blk Blk;
+typedef BigUnsigned::Index Index;
+
+// Returns the length of x[0..xn) without leading zero blocks.
+Index trimmed(const Blk* x, Index xn)
+{
+    while (xn > 0 && x[xn - 1] == 0)
+        xn--;
+    return xn;
+}
+
+// Returns whether x[0..n) >= y[0..n).
+bool atLeast(const Blk* x, const Blk* y, Index n)
+{
+    Index i = detail::bitwiseKernels().highestDifference(x, y, n);
+    return i == 0 || x[i - 1] > y[i - 1];
+}
+} // namespace
+
+/*
+ * A modulus of L >= 2 blocks is 2^k - c with c < 2^N exactly when its
+ * blocks above block 0 are all ones up to bit k and block 0 is nonzero, and
+ * then c = 2^N - block 0.  It is 2^k + c exactly when its top bit is its
+ * only one above block 0, and then c = block 0.  A single-block modulus is
+ * done in block arithmetic.
+ */
+bool SpecialModulus::findShape(const BigUnsigned& modulus, Index& k, Blk& c, bool& plus)
+{
+    Index bits = modulus.bitLength();
+    if (bits < 2)
+        return false;
+    Index len = modulus.getLength();
+    Blk low = modulus.getBlock(0);
+    // 2^k - c with k = bits, or 2^k + c with k = bits - 1.
+    for (int form = 0; form < 2; form++) {
+        plus = (form == 1);
+        k = plus ? bits - 1 : bits;
+        if (len == 1) {
+            Blk twoK = (k == BigUnsigned::N) ? 0 : Blk(1) << k;
+            c = plus ? low - twoK : twoK - low;
+        } else {
+            unsigned int topBits = bits - BigUnsigned::N * (len - 1);
+            Blk ones = (topBits == BigUnsigned::N) ? ~Blk(0) : (Blk(1) << topBits) - 1;
+            Blk top = plus ? Blk(1) << (topBits - 1) : ones;
+            Blk middle = plus ? 0 : ~Blk(0);
+            bool matches = modulus.getBlock(len - 1) == top;
+            for (Index i = len - 1; matches && i-- > 1;)
+                matches = modulus.getBlock(i) == middle;
+            if (!matches || low == 0)
+                continue;
+            c = plus ? low : 0 - low;
+        }
+        if (c != 0 && BigUnsigned::N - detail::leadingZeros(c) <= k / 2)
+            return true;
+    }
+    return false;
+}
+
+bool SpecialModulus::isSpecial(const BigUnsigned& modulus)
+{
+    Index k;
+    Blk c;
+    bool plus;
+    return findShape(modulus, k, c, plus);
+}
+
+SpecialModulus::SpecialModulus(const BigUnsigned& modulus) : modulus(modulus)
+{
+    if (!findShape(modulus, k, c, plus))
+        throw MathError{ "SpecialModulus::SpecialModulus", "Modulus is not of the form 2^k - c or 2^k + c" };
+    n.resize(modulus.getLength());
+    for (Index i = 0; i < n.size(); i++)
+        n[i] = modulus.getBlock(i);
+}
+
+SpecialModulus::SpecialModulus(const BigUnsigned& modulus, Index k, Blk c, bool plus)
+    : modulus(modulus), k(k), c(c), plus(plus), n(modulus.getLength())
+{
+    for (Index i = 0; i < n.size(); i++)
+        n[i] = modulus.getBlock(i);
+}
+
+std::optional<SpecialModulus> SpecialModulus::tryMake(const BigUnsigned& modulus)
+{
+    Index k;
+    Blk c;
+    bool plus;
+    if (!findShape(modulus, k, c, plus))
+        return std::nullopt;
+    return SpecialModulus(modulus, k, c, plus);
+}
+
+const BigUnsigned& SpecialModulus::getModulus() const
+{
+    return modulus;
+}
+
+SpecialModulus::Index SpecialModulus::getShift() const
+{
+    return k;
+}
+
+SpecialModulus::Blk SpecialModulus::getOffset() const
+{
+    return c;
+}
+
+bool SpecialModulus::isPlus() const
+{
+    return plus;
+}
+
+bool SpecialModulus::isMersenne() const
+{
+    return !plus && c == 1;
+}
+
+SpecialModulus::Index SpecialModulus::getLength() const
+{
+    return Index(n.size());
+}
+
+/*
+ * Every fold shortens x by about k - log2(c) >= k / 2 bits, so a product of
+ * two reduced numbers needs only two or three folds.  For 2^k + c the
+ * difference l - h c may be negative; its magnitude is folded on and the sign
+ * is applied at the end.
+ */
+void SpecialModulus::reduceBlocks(Blk* x, Index xn, Blk* h) const
+{
+    const Index L = getLength();
+    const Index kBlocks = k / BigUnsigned::N;
+    const unsigned int kBits = unsigned(k % BigUnsigned::N);
+    const Blk lowMask = (Blk(1) << kBits) - 1;
+    bool negative = false;
+    xn = trimmed(x, xn);
+    // While x >= 2^k...
+    while (xn > kBlocks + 1 || (xn == kBlocks + 1 && (x[kBlocks] >> kBits) != 0)) {
+        // h = x >> k, x = x mod 2^k.
+        Index hn = xn - kBlocks;
+        for (Index i = 0; i < hn; i++) {
+            Blk next = (kBlocks + i + 1 < xn) ? x[kBlocks + i + 1] : 0;
+            h[i] = (kBits == 0) ? x[kBlocks + i] : (x[kBlocks + i] >> kBits) | (next << (BigUnsigned::N - kBits));
+        }
+        for (Index i = kBlocks + 1; i < xn; i++)
+            x[i] = 0;
+        x[kBlocks] &= lowMask;
+        xn = kBlocks + 1;
+        hn = trimmed(h, hn);
+        // h = h c
+        if (c != 1) {
+            Blk carry = 0;
+            for (Index i = 0; i < hn; i++) {
+                Blk hi;
+                Blk lo = detail::mulBlocks(h[i], c, hi);
+                lo += carry;
+                hi += (lo < carry);
+                h[i] = lo;
+                carry = hi;
+            }
+            h[hn++] = carry;
+        }
+        Index m = (hn > xn) ? hn : xn;
+        for (Index i = hn; i < m; i++)
+            h[i] = 0;
+        for (Index i = xn; i <= m; i++)
+            x[i] = 0;
+        if (!plus) {
+            // x = l + h c
+            x[m] = detail::addBlocks(x, x, h, m);
+            xn = m + 1;
+        }
+        else if (atLeast(x, h, m)) {
+            // x = l - h c
+            detail::subtractBlocks(x, x, h, m);
+            xn = m;
+        }
+        else {
+            // x = -(h c - l)
+            detail::subtractBlocks(x, h, x, m);
+            xn = m;
+            negative = !negative;
+        }
+        xn = trimmed(x, xn);
+    }
+    // Now x < 2^k < 2 modulus.
+    for (Index i = xn; i < L; i++)
+        x[i] = 0;
+    if (atLeast(x, n.data(), L))
+        detail::subtractBlocks(x, x, n.data(), L);
+    if (negative && trimmed(x, L) != 0)
+        detail::subtractBlocks(x, n.data(), x, L);
+}
+
+BigUnsigned SpecialModulus::reduce(const BigUnsigned& x) const
+{
+    Index L = getLength(), xn = x.getLength();
+    Index room = (xn > L ? xn : L) + 3;
+    std::vector<Blk> r(room, 0), h(room);
+    for (Index i = 0; i < xn; i++)
+        r[i] = x.getBlock(i);
+    reduceBlocks(r.data(), xn, h.data());
+    return BigUnsigned{ r.data(), L };
+}
+
+BigUnsigned SpecialModulus::multiply(const BigUnsigned& a, const BigUnsigned& b) const
+{
+    return reduce(a * b);
+}
+
+void SpecialModulus::multiplyBlocks(Blk* r, const Blk* a, const Blk* b, Blk* scratch) const
+{
+    Index L = getLength();
+    Blk* p = scratch;
+    Blk* h = scratch + 2 * L + 4;
+    if (a == b)
+        detail::squareBlocks(p, a, L);
+    else
+        detail::multiplyBlocks(p, a, L, b, L);
+    p[2 * L] = 0;
+    reduceBlocks(p, 2 * L, h);
+    for (Index i = 0; i < L; i++)
+        r[i] = p[i];
+}
+} // namespace fbi
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include "BigUnsigned.hh"
+#include "Exception.hh"
+
+namespace fbi {
+/* A SpecialModulus reduces modulo a number of the form 2^k - c or 2^k + c
+ * with a small c, such as the Mersenne numbers 2^p - 1 or 2^255 - 19.
+ *
+ * Writing x = h 2^k + l with l < 2^k, 2^k == c (resp. -c) gives
+ * x == h c + l (resp. l - h c), which is much shorter than x.  A few such
+ * folds, each costing a shift and one multiplication by the single-block c,
+ * replace the long division that `%' would do.
+ *
+ * A SpecialModulus is immutable once constructed, so it can be shared by any
+ * number of threads. */
+class SpecialModulus {
+public:
+    typedef BigUnsigned::Blk Blk;
+    typedef BigUnsigned::Index Index;
+
+    /* Returns whether modulus has the form 2^k - c or 2^k + c, where c >= 1
+     * fits in one block and has at most k / 2 bits. */
+    static bool isSpecial(const BigUnsigned& modulus);
+
+    // Throws a MathError if the modulus does not have a special form.
+    explicit SpecialModulus(const BigUnsigned& modulus);
+
+    /* Returns the SpecialModulus for modulus, or nothing if it does not have
+     * a special form.  Unlike isSpecial followed by the constructor, this
+     * looks for the form only once. */
+    static std::optional<SpecialModulus> tryMake(const BigUnsigned& modulus);
+
+    const BigUnsigned& getModulus() const;
+    // The modulus is 2^getShift() - getOffset(), or + getOffset() if isPlus().
+    Index getShift() const;
+    Blk getOffset() const;
+    bool isPlus() const;
+    // Whether the modulus is 2^k - 1.
+    bool isMersenne() const;
+    // The number of blocks of the modulus, and of every reduced value.
+    Index getLength() const;
+
+    // Returns x % modulus.
+    BigUnsigned reduce(const BigUnsigned& x) const;
+    // Returns (a * b) % modulus.
+    BigUnsigned multiply(const BigUnsigned& a, const BigUnsigned& b) const;
+
+    /* LOW-LEVEL INTERFACE
+     * Reduced values as fixed-length arrays of getLength() blocks, for long
+     * chains of multiplications. */
+
+    /* r = (a * b) % modulus for a, b < modulus.  r may alias a or b.
+     * scratch must hold 4 getLength() + 8 blocks. */
+    void multiplyBlocks(Blk* r, const Blk* a, const Blk* b, Blk* scratch) const;
+
+protected:
+    BigUnsigned modulus;
+    Index k;
+    Blk c;
+    bool plus;
+    // The modulus as a block array of length getLength().
+    std::vector<Blk> n;
+
+    SpecialModulus(const BigUnsigned& modulus, Index k, Blk c, bool plus);
+
+    /* Finds k, c and plus for the modulus; returns false if it does not have
+     * a special form.  Reads the blocks of the modulus without allocating,
+     * and gives up at the first block that rules a form out. */
+    static bool findShape(const BigUnsigned& modulus, Index& k, Blk& c, bool& plus);
+
+    /* Reduces x[0..xn) in place to x[0..getLength()).  x and h must both
+     * have room for max(xn, getLength()) + 3 blocks. */
+    void reduceBlocks(Blk* x, Index xn, Blk* h) const;
+};
+} // namespace fbi
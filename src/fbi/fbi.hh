@@ -6,4 +6,8 @@
 #include "BigIntegerUtils.hh"
 #include "BigUnsigned.hh"
 #include "BigUnsignedInABase.hh"
+#include "CpuFeatures.hh"
+#include "FixedBaseExp.hh"
+#include "MontgomeryContext.hh"
 #include "NumberlikeArray.hh"
+#include "SpecialModulus.hh"
@@ -0,0 +1,772 @@
+#pragma once
+
+#pragma warning(push)
+// Disable gtest warnings
+#pragma warning(disable : 26495)
+#pragma warning(disable : 26812)
+
+#include <algorithm>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "BigUnsignedTests.hh"
+
+#include <gtest/gtest.h>
+
+#include <fbi/fbi.hh>
+
+using namespace fbi;
+
+namespace algorithms {
+using bigunsigned::randomBigUnsigned;
+
+// x^e by repeated multiplication, used as a reference.
+inline BigUnsigned powSlow(const BigUnsigned& x, BigUnsigned::Index e)
+{
+    BigUnsigned r = 1;
+    for (BigUnsigned::Index i = 0; i < e; i++)
+        r *= x;
+    return r;
+}
+
+// The textbook extended Euclidean algorithm, used as a reference.
+inline void classicExtendedEuclidean(
+    BigInteger m, BigInteger n, BigInteger& g, BigInteger& r, BigInteger& s)
+{
+    BigInteger r1(1), s1(0), r2(0), s2(1), q;
+    for (;;) {
+        if (n.isZero()) {
+            r = r1;
+            s = s1;
+            g = m;
+            return;
+        }
+        m.divideWithRemainder(n, q);
+        r1 -= q * r2;
+        s1 -= q * s2;
+        if (m.isZero()) {
+            r = r2;
+            s = s2;
+            g = n;
+            return;
+        }
+        n.divideWithRemainder(m, q);
+        r2 -= q * r1;
+        s2 -= q * s1;
+    }
+}
+
+inline void testExtendedEuclidean(const BigUnsigned& m, const BigUnsigned& n)
+{
+    BigInteger g, r, s, g2, r2, s2;
+    extendedEuclidean(m, n, g, r, s);
+    classicExtendedEuclidean(m, n, g2, r2, s2);
+    EXPECT_EQ(g, g2);
+    EXPECT_EQ(r, r2);
+    EXPECT_EQ(s, s2);
+    EXPECT_EQ(r * m + s * n, g);
+    EXPECT_EQ(gcd(m, n), g.getMagnitude());
+
+    BigInteger g3, r3;
+    extendedEuclidean(m, n, g3, r3);
+    EXPECT_EQ(g3, g);
+    EXPECT_EQ(r3, r);
+}
+
+// Square-and-multiply with a division after every step, used as a reference.
+inline BigUnsigned classicModexp(const BigUnsigned& base, const BigUnsigned& exponent, const BigUnsigned& modulus)
+{
+    BigUnsigned ans = BigUnsigned(1) % modulus, base2 = base % modulus;
+    for (BigUnsigned::Index i = exponent.bitLength(); i > 0; --i) {
+        ans = ans * ans % modulus;
+        if (exponent.getBit(i - 1))
+            ans = ans * base2 % modulus;
+    }
+    return ans;
+}
+} // namespace algorithms
+
+TEST(BigIntegerAlgorithms, ExtendedEuclideanSmall)
+{
+    using namespace algorithms;
+
+    testExtendedEuclidean(0, 0);
+    testExtendedEuclidean(0, 5);
+    testExtendedEuclidean(5, 0);
+    testExtendedEuclidean(60, 72);
+    testExtendedEuclidean(72, 60);
+    testExtendedEuclidean(1, 1);
+    testExtendedEuclidean(17, 1);
+    testExtendedEuclidean(BigUnsigned{ "18446744073709551615" }, BigUnsigned{ "18446744073709551557" });
+}
+
+TEST(BigIntegerAlgorithms, ExtendedEuclideanLarge)
+{
+    using namespace algorithms;
+
+    std::mt19937_64 rng(26);
+    for (BigUnsigned::Index len = 1; len <= 12; ++len) {
+        BigUnsigned a = randomBigUnsigned(rng, len);
+        BigUnsigned b = randomBigUnsigned(rng, len);
+        BigUnsigned c = randomBigUnsigned(rng, len / 2 + 1);
+        testExtendedEuclidean(a, b);
+        testExtendedEuclidean(a * c, b * c);
+        testExtendedEuclidean(a, randomBigUnsigned(rng, len / 3 + 1));
+    }
+}
+
+TEST(BigIntegerAlgorithms, ExtendedEuclideanHalfGcd)
+{
+    using namespace algorithms;
+
+    // Long enough for the half-gcd path, short enough for the reference.
+    std::mt19937_64 rng(27);
+    testExtendedEuclidean(randomBigUnsigned(rng, 64), randomBigUnsigned(rng, 64));
+    testExtendedEuclidean(randomBigUnsigned(rng, 120), randomBigUnsigned(rng, 110));
+
+    for (BigUnsigned::Index len : { 200, 450, 900 }) {
+        BigUnsigned c = randomBigUnsigned(rng, 5);
+        BigUnsigned m = randomBigUnsigned(rng, len) * c, n = randomBigUnsigned(rng, len) * c;
+        BigInteger g, r, s;
+        extendedEuclidean(m, n, g, r, s);
+        EXPECT_EQ(r * m + s * n, g);
+        EXPECT_EQ(m % g.getMagnitude(), 0);
+        EXPECT_EQ(n % g.getMagnitude(), 0);
+        EXPECT_EQ(g.getMagnitude() % c, 0);
+        // The Euclidean cofactors are bounded by half the reduced inputs.
+        EXPECT_LE(r.getMagnitude() * 2, n / g.getMagnitude());
+        EXPECT_LE(s.getMagnitude() * 2, m / g.getMagnitude());
+        EXPECT_EQ(gcd(m, n), g.getMagnitude());
+    }
+}
+
+TEST(BigIntegerAlgorithms, ExtendedEuclideanSigns)
+{
+    BigInteger g, r, s;
+    extendedEuclidean(-60, 72, g, r, s);
+    EXPECT_EQ(g, 12);
+    EXPECT_EQ(r * -60 + s * 72, g);
+    extendedEuclidean(60, -72, g, r, s);
+    EXPECT_EQ(g, 12);
+    EXPECT_EQ(r * 60 + s * -72, g);
+}
+
+TEST(BigIntegerAlgorithms, ModularInverse)
+{
+    using namespace algorithms;
+
+    EXPECT_EQ(modinv(BigUnsigned(7), 11), 8);
+    EXPECT_EQ(modinv(-3, 7), 2);
+    EXPECT_THROW(modinv(6, 9), std::runtime_error);
+
+    std::mt19937_64 rng(2048);
+    // A 2048-bit odd modulus.
+    BigUnsigned n = randomBigUnsigned(rng, 32);
+    n.setBit(0, true);
+    for (int i = 0; i < 8; ++i) {
+        BigUnsigned x = randomBigUnsigned(rng, 31);
+        if (gcd(x, n) != 1)
+            continue;
+        BigUnsigned inv = modinv(x, n);
+        EXPECT_LT(inv, n);
+        EXPECT_EQ((inv * x) % n, 1);
+    }
+}
+
+TEST(BigIntegerAlgorithms, BatchModularInverse)
+{
+    using namespace algorithms;
+
+    std::mt19937_64 rng(28);
+    // n = p * c with a small factor c, so some elements are not invertible.
+    const BigUnsigned c = 1009;
+    BigUnsigned n = randomBigUnsigned(rng, 8) * c;
+    std::vector<BigUnsigned> xs;
+    for (int i = 0; i < 40; ++i)
+        xs.push_back(randomBigUnsigned(rng, 1 + i % 10));
+    xs[3] = 0;
+    xs[7] = c * 12345;
+    xs[8] = n;
+    xs[20] = n + 1;
+    xs[39] = c;
+
+    std::vector<bool> invertible;
+    std::vector<BigUnsigned> inv = batchModinv(xs.data(), xs.size(), n, invertible);
+    ASSERT_EQ(inv.size(), xs.size());
+    ASSERT_EQ(invertible.size(), xs.size());
+    for (std::size_t i = 0; i < xs.size(); ++i) {
+        bool expected = gcd(xs[i], n) == 1;
+        EXPECT_EQ(invertible[i], expected);
+        if (expected) {
+            EXPECT_EQ(inv[i], modinv(xs[i], n));
+        }
+        else {
+            EXPECT_EQ(inv[i], 0);
+        }
+    }
+    EXPECT_FALSE(invertible[3]);
+    EXPECT_FALSE(invertible[7]);
+    EXPECT_TRUE(invertible[20]);
+    EXPECT_EQ(inv[20], 1);
+
+    // Empty and single-element batches.
+    EXPECT_TRUE(batchModinv(xs.data(), 0, n, invertible).empty());
+    inv = batchModinv(xs.data() + 20, 1, n, invertible);
+    EXPECT_TRUE(invertible[0]);
+    EXPECT_EQ(inv[0], 1);
+    EXPECT_THROW(batchModinv(xs.data(), 1, 0, invertible), DivideByZeroError);
+}
+
+TEST(BigIntegerAlgorithms, MontgomeryContext)
+{
+    using namespace algorithms;
+
+    std::mt19937_64 rng(29);
+    for (BigUnsigned::Index blocks : { 1, 2, 5, 17 }) {
+        BigUnsigned n = randomBigUnsigned(rng, blocks) | 1;
+        MontgomeryContext ctx(n);
+        EXPECT_EQ(ctx.getModulus(), n);
+        EXPECT_EQ(ctx.getLength(), blocks);
+        EXPECT_EQ(ctx.fromMontgomery(ctx.one()), BigUnsigned(1) % n);
+        for (int i = 0; i < 10; ++i) {
+            BigUnsigned a = randomBigUnsigned(rng, blocks) % n, b = randomBigUnsigned(rng, blocks + 1);
+            BigUnsigned am = ctx.toMontgomery(a), bm = ctx.toMontgomery(b);
+            EXPECT_EQ(ctx.fromMontgomery(am), a);
+            EXPECT_EQ(ctx.fromMontgomery(ctx.multiply(am, bm)), a * b % n);
+        }
+        // Exponent lengths across every sliding window width.
+        for (BigUnsigned::Index eBlocks : { 1, 2, 8, 32 }) {
+            BigUnsigned g = randomBigUnsigned(rng, blocks), e = randomBigUnsigned(rng, eBlocks) >> 3;
+            EXPECT_EQ(ctx.exp(g, e), classicModexp(g, e, n));
+        }
+    }
+    // All-ones moduli exercise every carry in the reduction.
+    BigUnsigned allOnes = (BigUnsigned(1) << 256) - 1;
+    MontgomeryContext ctx(allOnes);
+    BigUnsigned a = allOnes - 1;
+    EXPECT_EQ(ctx.fromMontgomery(ctx.multiply(ctx.toMontgomery(a), ctx.toMontgomery(a))), 1);
+
+    EXPECT_THROW(MontgomeryContext(BigUnsigned(0)), MathError);
+    EXPECT_THROW(MontgomeryContext(BigUnsigned(10)), MathError);
+}
+
+TEST(BigIntegerAlgorithms, ModularExponentiation)
+{
+    using namespace algorithms;
+
+    EXPECT_EQ(modexp(BigUnsigned(314), 159, 2653), 1931);
+    EXPECT_EQ(modexp(5, 0, 7), 1);
+    EXPECT_EQ(modexp(5, 0, 1), 0);
+    EXPECT_EQ(modexp(0, 0, 8), 1);
+    EXPECT_EQ(modexp(-2, 3, 7), 6);
+    EXPECT_EQ(modexp(-2, 3, 12), 4);
+    EXPECT_THROW(modexp(2, 3, 0), DivideByZeroError);
+
+    std::mt19937_64 rng(2029);
+    for (int i = 0; i < 40; ++i) {
+        BigUnsigned::Index blocks = 1 + i % 6;
+        BigUnsigned odd = randomBigUnsigned(rng, blocks) | 1;
+        // Odd, 2^k m, and pure power-of-two moduli.
+        BigUnsigned moduli[] = { odd, odd << (1 + i * 7 % 150), BigUnsigned(1) << (1 + i * 13 % 300) };
+        for (const BigUnsigned& n : moduli) {
+            BigUnsigned base = randomBigUnsigned(rng, blocks + i % 3);
+            if (i % 4 == 0)
+                base <<= 5;
+            BigUnsigned exponent = randomBigUnsigned(rng, 1 + i % 3);
+            EXPECT_EQ(modexp(base, exponent, n), classicModexp(base, exponent, n));
+            EXPECT_EQ(modexp(base, i, n), classicModexp(base, i, n));
+        }
+    }
+}
+
+TEST(BigIntegerAlgorithms, ConstantTimeModularExponentiation)
+{
+    using namespace algorithms;
+
+    EXPECT_EQ(modexpConstantTime(314, 159, 2653), 1931);
+    EXPECT_EQ(modexpConstantTime(5, 0, 7), 1);
+    EXPECT_EQ(modexpConstantTime(0, 0, 7), 1);
+    EXPECT_EQ(modexpConstantTime(5, 3, 1), 0);
+    EXPECT_THROW(modexpConstantTime(5, 3, 8), MathError);
+
+    std::mt19937_64 rng(32);
+    for (int i = 0; i < 30; ++i) {
+        BigUnsigned n = randomBigUnsigned(rng, 1 + i % 7) | 1;
+        BigUnsigned base = randomBigUnsigned(rng, 1 + i % 9);
+        BigUnsigned exponent = randomBigUnsigned(rng, 1 + i % 10);
+        EXPECT_EQ(modexpConstantTime(base, exponent, n), classicModexp(base, exponent, n));
+    }
+    // The all-ones modulus makes the final subtraction of nearly every step matter.
+    BigUnsigned n = (BigUnsigned(1) << 192) - 1, base = n - 2;
+    EXPECT_EQ(modexpConstantTime(base, n, n), classicModexp(base, n, n));
+}
+
+TEST(BigIntegerAlgorithms, FixedBaseExponentiation)
+{
+    using namespace algorithms;
+
+    std::mt19937_64 rng(30);
+    for (BigUnsigned::Index bits : { 1, 10, 64, 200, 1000 }) {
+        BigUnsigned n = randomBigUnsigned(rng, 1 + bits / 200) | 1;
+        BigUnsigned g = randomBigUnsigned(rng, 2 + bits / 200);
+        FixedBaseExp fixed(g, n, bits);
+        EXPECT_EQ(fixed.getBase(), g % n);
+        EXPECT_EQ(fixed.getModulus(), n);
+        EXPECT_GE(fixed.getMaxExponentBits(), bits);
+        EXPECT_EQ(fixed.exp(0), BigUnsigned(1) % n);
+        for (int i = 0; i < 10; ++i) {
+            BigUnsigned e = randomBigUnsigned(rng, (bits + 63) / 64) >> int(i % 64);
+            EXPECT_EQ(fixed.exp(e), classicModexp(g, e, n));
+        }
+        // Exponents longer than the comb still work.
+        BigUnsigned e = randomBigUnsigned(rng, bits / 64 + 2);
+        EXPECT_EQ(fixed.exp(e), classicModexp(g, e, n));
+    }
+
+    FixedBaseExp negative(-3, 101, 16);
+    EXPECT_EQ(negative.exp(3), 74);
+    EXPECT_THROW(FixedBaseExp(2, 100, 16), MathError);
+    EXPECT_THROW(FixedBaseExp(2, 0, 16), MathError);
+}
+
+TEST(BigIntegerAlgorithms, MultiExponentiation)
+{
+    using namespace algorithms;
+
+    EXPECT_EQ(multiExp({}, {}, 7), 1);
+    EXPECT_EQ(multiExp({ 3, -2 }, { 4, 3 }, 1), 0);
+    EXPECT_EQ(multiExp({ 3, -2 }, { 4, 3 }, 100), 52);
+    EXPECT_EQ(multiExp({ 3, -2 }, { 4, 3 }, 101), 59);
+    EXPECT_THROW(multiExp({ 3 }, { 4, 3 }, 101), MathError);
+    EXPECT_THROW(multiExp({ 3 }, { 4 }, 0), DivideByZeroError);
+
+    std::mt19937_64 rng(31);
+    // Two bases go through Straus's method, hundreds through Pippenger's.
+    for (std::size_t count : { 1, 2, 5, 300 }) {
+        BigUnsigned odd = randomBigUnsigned(rng, 3) | 1;
+        for (const BigUnsigned& n : { odd, odd << 70, BigUnsigned(1) << 100 }) {
+            std::vector<BigInteger> bases;
+            std::vector<BigUnsigned> exponents;
+            BigUnsigned expected = 1;
+            for (std::size_t i = 0; i < count; ++i) {
+                BigUnsigned g = randomBigUnsigned(rng, 1 + i % 4), e = randomBigUnsigned(rng, 1 + i % 3) >> int(i);
+                if (i % 7 == 3)
+                    e = 0;
+                if (i % 5 == 1)
+                    g <<= 3;
+                bases.push_back(g);
+                exponents.push_back(e);
+                expected = expected * classicModexp(g, e, n) % n;
+            }
+            EXPECT_EQ(multiExp(bases, exponents, n), expected);
+        }
+    }
+}
+
+TEST(BigIntegerAlgorithms, SpecialModulus)
+{
+    using namespace algorithms;
+
+    const BigUnsigned one = 1;
+    EXPECT_TRUE(SpecialModulus::isSpecial((one << 127) - 1));
+    EXPECT_TRUE(SpecialModulus::isSpecial((one << 255) - 19));
+    EXPECT_TRUE(SpecialModulus::isSpecial((one << 200) + 235));
+    EXPECT_FALSE(SpecialModulus::isSpecial(one << 200));
+    EXPECT_FALSE(SpecialModulus::isSpecial((one << 200) - (one << 150)));
+    EXPECT_FALSE(SpecialModulus::isSpecial(1));
+    EXPECT_THROW(SpecialModulus(BigUnsigned(12345) << 100), MathError);
+    EXPECT_FALSE(SpecialModulus::tryMake((one << 200) - (one << 150)));
+    EXPECT_FALSE(SpecialModulus::tryMake((one << 256) - (one << 64)));
+    std::optional<SpecialModulus> plus = SpecialModulus::tryMake((one << 256) + 0xffffffffull);
+    ASSERT_TRUE(plus);
+    EXPECT_EQ(plus->getShift(), 256);
+    EXPECT_EQ(plus->getOffset(), 0xffffffffull);
+    EXPECT_TRUE(plus->isPlus());
+
+    SpecialModulus p25519((one << 255) - 19);
+    EXPECT_EQ(p25519.getShift(), 255);
+    EXPECT_EQ(p25519.getOffset(), 19);
+    EXPECT_FALSE(p25519.isPlus());
+    EXPECT_FALSE(p25519.isMersenne());
+    EXPECT_TRUE(SpecialModulus((one << 521) - 1).isMersenne());
+
+    std::mt19937_64 rng(33);
+    // Shapes whose k is and is not a multiple of the block size.
+    const BigUnsigned moduli[] = { (one << 127) - 1,      (one << 255) - 19,        (one << 256) - 0xffffffffull,
+                                   (one << 200) + 235,    (one << 192) + 1,         (one << 1279) - 1,
+                                   (one << 1280) + 12345, (one << 2048) - 1942289ull, 7 };
+    for (const BigUnsigned& n : moduli) {
+        SpecialModulus special(n);
+        BigUnsigned::Index blocks = n.getLength();
+        EXPECT_EQ(special.getLength(), blocks);
+        EXPECT_EQ(special.reduce(0), 0);
+        EXPECT_EQ(special.reduce(n), 0);
+        EXPECT_EQ(special.reduce(n - 1), n - 1);
+        EXPECT_EQ(special.multiply(n - 1, n - 1), 1);
+        for (int i = 0; i < 20; ++i) {
+            BigUnsigned a = randomBigUnsigned(rng, blocks) % n, b = randomBigUnsigned(rng, blocks) % n;
+            BigUnsigned x = randomBigUnsigned(rng, 1 + i * blocks / 3);
+            EXPECT_EQ(special.reduce(x), x % n);
+            EXPECT_EQ(special.multiply(a, b), a * b % n);
+            EXPECT_EQ(modmul(a, b, n), a * b % n);
+        }
+        BigUnsigned base = randomBigUnsigned(rng, blocks), exponent = randomBigUnsigned(rng, 2);
+        EXPECT_EQ(modexp(base, exponent, n), classicModexp(base, exponent, n));
+    }
+    EXPECT_EQ(modmul(12345, 6789, 1000), 205);
+    EXPECT_THROW(modmul(1, 2, 0), DivideByZeroError);
+}
+
+TEST(BigIntegerAlgorithms, SquareRoot)
+{
+    using namespace algorithms;
+
+    BigUnsigned r;
+    EXPECT_EQ(sqrtRem(0, r), 0);
+    EXPECT_EQ(r, 0);
+    EXPECT_EQ(sqrtRem(1, r), 1);
+    EXPECT_EQ(r, 0);
+    EXPECT_EQ(sqrtRem(99, r), 9);
+    EXPECT_EQ(r, 18);
+    EXPECT_EQ(isqrt(~BigUnsigned::Blk(0)), 0xffffffffull);
+    EXPECT_EQ(isqrt(BigUnsigned(1) << 64), BigUnsigned(1) << 32);
+
+    std::mt19937_64 rng(45);
+    // Lengths from one block up to several levels of the recursion.
+    for (BigUnsigned::Index blocks : { 1, 2, 3, 4, 5, 8, 13, 32, 75, 200 })
+        for (int i = 0; i < 10; i++) {
+            BigUnsigned n = (randomBigUnsigned(rng, blocks) >> int(rng() % 64)) + 1;
+            BigUnsigned s = sqrtRem(n, r);
+            EXPECT_EQ(s * s + r, n);
+            EXPECT_LE(r, s * 2);
+            EXPECT_EQ(isqrt(n), s);
+            // Squares and their neighbours.
+            BigUnsigned square = s * s;
+            EXPECT_EQ(sqrtRem(square, r), s);
+            EXPECT_EQ(r, 0);
+            EXPECT_TRUE(isPerfectSquare(square));
+            EXPECT_FALSE(isPerfectSquare(square + 1));
+            EXPECT_FALSE(isPerfectSquare(square - 1));
+            EXPECT_EQ(isqrt(square - 1), s - 1);
+            BigUnsigned next = square + s * 2;
+            EXPECT_EQ(isqrt(next), s);
+            EXPECT_EQ(isqrt(next + 1), s + 1);
+        }
+
+    // The remainder may go to the input itself.
+    BigUnsigned n = 1000001;
+    EXPECT_EQ(sqrtRem(n, n), 1000);
+    EXPECT_EQ(n, 1);
+
+    // Every non-square below 5000 is rejected, and every square accepted.
+    for (unsigned int i = 0, root = 0; i < 5000; i++) {
+        if ((root + 1) * (root + 1) == i)
+            root++;
+        EXPECT_EQ(isPerfectSquare(i), root * root == i) << i;
+    }
+}
+
+TEST(BigIntegerAlgorithms, IntegerRoots)
+{
+    using namespace algorithms;
+
+    EXPECT_THROW(iroot(8, 0), MathError);
+    EXPECT_EQ(iroot(0, 5), 0);
+    EXPECT_EQ(iroot(12345, 1), 12345);
+    EXPECT_EQ(iroot(26, 3), 2);
+    EXPECT_EQ(iroot(27, 3), 3);
+    EXPECT_EQ(iroot(BigUnsigned(1) << 300, 100), 8);
+    EXPECT_EQ(iroot((BigUnsigned(1) << 300) - 1, 100), 7);
+    EXPECT_EQ(iroot(1000, 50), 1);
+
+    std::mt19937_64 rng(46);
+    // The longest lengths go through the recursive seed for k = 3 and 4.
+    for (BigUnsigned::Index blocks : { 1, 2, 5, 16, 40, 150 })
+        for (BigUnsigned::Index k : { 2, 3, 4, 5, 7, 12, 31, 64, 65, 100 }) {
+            BigUnsigned n = randomBigUnsigned(rng, blocks);
+            BigUnsigned x = iroot(n, k);
+            BigUnsigned::Index e = k;
+            EXPECT_LE(powSlow(x, e), n) << blocks << " " << k;
+            EXPECT_GT(powSlow(x + 1, e), n) << blocks << " " << k;
+            // Exact powers and their neighbours.
+            BigUnsigned xk = powSlow(x, e);
+            EXPECT_EQ(iroot(xk, k), x);
+            if (x > 1) {
+                EXPECT_EQ(iroot(xk - 1, k), x - 1);
+            }
+        }
+}
+
+TEST(BigIntegerAlgorithms, PerfectPowers)
+{
+    using namespace algorithms;
+
+    BigUnsigned base;
+    BigUnsigned::Index exponent;
+    EXPECT_TRUE(isPerfectPower(0, base, exponent));
+    EXPECT_TRUE(isPerfectPower(1, base, exponent));
+    EXPECT_EQ(base, 1);
+    EXPECT_FALSE(isPerfectPower(2, base, exponent));
+    EXPECT_EQ(base, 2);
+    EXPECT_EQ(exponent, 1u);
+    EXPECT_TRUE(isPerfectPower(64, base, exponent));
+    EXPECT_EQ(base, 2);
+    EXPECT_EQ(exponent, 6u);
+    EXPECT_TRUE(isPerfectPower(BigUnsigned(1) << 1000, base, exponent));
+    EXPECT_EQ(base, 2);
+    EXPECT_EQ(exponent, 1000u);
+
+    // Against a brute-force search below 3000.
+    for (unsigned int n = 2; n < 3000; n++) {
+        unsigned int bestBase = n, bestExponent = 1;
+        for (unsigned int b = 2; b * b <= n; b++) {
+            unsigned int e = 0, m = n;
+            while (m % b == 0) {
+                m /= b;
+                e++;
+            }
+            if (m == 1) {
+                bestBase = b;
+                bestExponent = e;
+                break;
+            }
+        }
+        EXPECT_EQ(isPerfectPower(n, base, exponent), bestExponent > 1) << n;
+        EXPECT_EQ(base, bestBase) << n;
+        EXPECT_EQ(exponent, bestExponent) << n;
+    }
+
+    // Large powers, including ones of composite and repeated exponents, and
+    // near misses.
+    std::mt19937_64 rng(47);
+    for (BigUnsigned::Index e : { 2, 3, 5, 6, 9, 13, 25, 36, 101 }) {
+        BigUnsigned x = randomBigUnsigned(rng, 3) | 3;
+        BigUnsigned n = powSlow(x, e);
+        EXPECT_TRUE(isPerfectPower(n, base, exponent)) << e;
+        EXPECT_EQ(base, x) << e;
+        EXPECT_EQ(exponent, e) << e;
+        EXPECT_FALSE(isPerfectPower(n + 2, base, exponent)) << e;
+        EXPECT_EQ(base, n + 2);
+        EXPECT_TRUE(isPerfectPower(n * n, base, exponent)) << e;
+        EXPECT_EQ(exponent, 2 * e) << e;
+    }
+}
+
+TEST(BigIntegerAlgorithms, Power)
+{
+    using namespace algorithms;
+
+    EXPECT_EQ(pow(BigUnsigned(0), 0), 1);
+    EXPECT_EQ(pow(BigUnsigned(0), 5), 0);
+    EXPECT_EQ(pow(BigUnsigned(7), 0), 1);
+    EXPECT_EQ(pow(BigUnsigned(1), 1000000), 1);
+    EXPECT_EQ(pow(BigUnsigned(10), 19), 10000000000000000000ull);
+    EXPECT_EQ(pow(BigUnsigned(2), 1000), BigUnsigned(1) << 1000);
+    EXPECT_EQ(pow(BigUnsigned(12), 100), pow(BigUnsigned(3), 100) << 200);
+    EXPECT_EQ(pow(BigInteger(-3), 3), -27);
+    EXPECT_EQ(pow(BigInteger(-3), 4), 81);
+    EXPECT_EQ(pow(BigInteger(0), 3), 0);
+    EXPECT_EQ(pow(BigUnsigned(1), 1ull << 40), 1);
+    EXPECT_EQ(pow(BigInteger(-1), 1ull << 40), 1);
+    EXPECT_EQ(pow(BigInteger(-1), (1ull << 40) + 1), -1);
+    EXPECT_THROW(pow(BigUnsigned(3), 1ull << 40), MathError);
+
+    std::mt19937_64 rng(47);
+    for (BigUnsigned::Index blocks : { 1, 2, 7 })
+        for (BigUnsigned::Index e : { 1, 2, 3, 10, 31, 64, 100 }) {
+            BigUnsigned x = randomBigUnsigned(rng, blocks) << int(rng() % 100);
+            EXPECT_EQ(pow(x, e), powSlow(x, e)) << blocks << " " << e;
+        }
+
+    // 3^100000 against its length and its last five decimal digits.
+    BigUnsigned big = pow(BigUnsigned(3), 100000);
+    EXPECT_EQ(big.bitLength(), 158497u);
+    EXPECT_EQ(big % 100000, 1);
+    EXPECT_EQ(iroot(big, 100000), 3);
+}
+
+TEST(BigIntegerAlgorithms, Products)
+{
+    using namespace algorithms;
+
+    BigUnsigned f = 1;
+    for (BigUnsigned::Index n = 0; n <= 3000; n++) {
+        if (n > 0)
+            f *= n;
+        if (n <= 300 || n % 97 == 0) {
+            ASSERT_EQ(factorial(n), f) << n;
+        }
+    }
+    EXPECT_EQ(factorial(20), 2432902008176640000ull);
+    EXPECT_EQ(factorial(3000) / factorial(2999), 3000);
+    EXPECT_THROW(factorial(1u << 30), MathError);
+
+    BigUnsigned even = 1, odd = 1;
+    EXPECT_EQ(doubleFactorial(0), 1);
+    for (BigUnsigned::Index n = 1; n <= 1001; n++) {
+        BigUnsigned& d = (n % 2 == 0) ? even : odd;
+        d *= n;
+        ASSERT_EQ(doubleFactorial(n), d) << n;
+    }
+    EXPECT_EQ(doubleFactorial(2001) * doubleFactorial(2000), factorial(2001));
+
+    // Pascal's triangle, which takes both paths of binomial.
+    std::vector<BigUnsigned> row(1, 1);
+    for (BigUnsigned::Index n = 1; n <= 200; n++) {
+        std::vector<BigUnsigned> next(n + 1, 1);
+        for (BigUnsigned::Index k = 1; k < n; k++)
+            next[k] = row[k - 1] + row[k];
+        row.swap(next);
+        for (BigUnsigned::Index k = 0; k <= n; k++)
+            ASSERT_EQ(binomial(n, k), row[k]) << n << " " << k;
+        EXPECT_EQ(binomial(n, n + 1), 0);
+    }
+    BigUnsigned::Index n = 4000000000u;
+    EXPECT_EQ(binomial(n, 3), BigUnsigned(n) * (n - 1) * (n - 2) / 6);
+    EXPECT_EQ(binomial(n, n - 1), n);
+    EXPECT_EQ(binomial(5000, 2500), factorial(5000) / (factorial(2500) * factorial(2500)));
+
+    EXPECT_EQ(primorial(0), 1);
+    EXPECT_EQ(primorial(2), 2);
+    EXPECT_EQ(primorial(30), 6469693230ull);
+    BigUnsigned p = 1;
+    for (BigUnsigned::Index q = 2; q <= 10000; q++) {
+        bool prime = true;
+        for (BigUnsigned::Index d = 2; d * d <= q && prime; d++)
+            prime = q % d != 0;
+        if (prime)
+            p *= q;
+    }
+    EXPECT_EQ(primorial(10000), p);
+
+    std::mt19937_64 rng(48);
+    std::vector<BigUnsigned> factors;
+    BigUnsigned product = 1;
+    EXPECT_EQ(productOf(factors.data(), 0), 1);
+    for (int i = 0; i < 300; i++) {
+        BigUnsigned x = randomBigUnsigned(rng, BigUnsigned::Index(rng() % 4 == 0 ? 1 + rng() % 20 : 1));
+        factors.push_back(x);
+        product *= x;
+    }
+    EXPECT_EQ(productOf(factors.data(), factors.size()), product);
+    EXPECT_EQ(productOf(factors.begin(), factors.end()), product);
+    std::vector<unsigned int> small = { 3, 5, 7, 11 };
+    EXPECT_EQ(productOf(small.begin(), small.end()), 1155);
+    factors[123] = 0;
+    EXPECT_EQ(productOf(factors.data(), factors.size()), 0);
+}
+
+TEST(BigIntegerAlgorithms, Primality)
+{
+    using namespace algorithms;
+
+    // Every number below 2^20, which covers the trial division table.
+    std::vector<bool> composite(1 << 20);
+    composite[0] = composite[1] = true;
+    for (unsigned int p = 2; p < composite.size(); p++)
+        if (!composite[p])
+            for (unsigned int m = 2 * p; m < composite.size(); m += p)
+                composite[m] = true;
+    for (unsigned int n = 0; n < composite.size(); n++) {
+        ASSERT_EQ(isProbablePrime(n, 1), !composite[n]) << n;
+        if (n < 100000) {
+            ASSERT_EQ(isBPSWPrime(n), !composite[n]) << n;
+        }
+    }
+
+    // Strong pseudoprimes: to base 2, to bases up to 23 (below 2^64), and to
+    // bases up to 37 and 41 (above 2^64).
+    for (const char* n : { "2047", "3215031751", "3825123056546413051", "318665857834031151167461",
+                           "3317044064679887385961981" }) {
+        EXPECT_FALSE(isProbablePrime(stringToBigUnsigned(n), 10)) << n;
+        EXPECT_FALSE(isBPSWPrime(stringToBigUnsigned(n))) << n;
+    }
+    // Carmichael numbers.
+    for (const char* n : { "561", "41041", "825265", "321197185", "5394826801", "232250619601" }) {
+        EXPECT_FALSE(isProbablePrime(stringToBigUnsigned(n), 10)) << n;
+        EXPECT_FALSE(isBPSWPrime(stringToBigUnsigned(n))) << n;
+    }
+
+    // Mersenne numbers 2^p - 1, of which these are prime.
+    std::vector<int> mersenne = { 61, 89, 107, 127, 521, 607, 1279 };
+    for (int p : { 61, 67, 89, 101, 107, 127, 257, 521, 523, 607, 1279 }) {
+        BigUnsigned m = (BigUnsigned(1) << p) - 1;
+        bool prime = std::find(mersenne.begin(), mersenne.end(), p) != mersenne.end();
+        EXPECT_EQ(isProbablePrime(m, 5), prime) << p;
+        EXPECT_EQ(isBPSWPrime(m), prime) << p;
+    }
+    BigUnsigned semiprime = ((BigUnsigned(1) << 89) - 1) * ((BigUnsigned(1) << 107) - 1);
+    EXPECT_FALSE(isProbablePrime(semiprime, 5));
+    EXPECT_FALSE(isBPSWPrime(semiprime));
+    EXPECT_FALSE(isBPSWPrime(((BigUnsigned(1) << 127) - 1) * ((BigUnsigned(1) << 127) - 1)));
+
+    // The two tests agree on random odd numbers of a few blocks.
+    std::mt19937_64 rng(49);
+    int primes = 0;
+    for (int i = 0; i < 2000; i++) {
+        BigUnsigned n = randomBigUnsigned(rng, BigUnsigned::Index(1 + i % 3)) | 1;
+        bool prime = isBPSWPrime(n);
+        EXPECT_EQ(isProbablePrime(n, 10), prime) << n;
+        primes += prime;
+    }
+    EXPECT_GT(primes, 20);
+}
+
+TEST(BigIntegerAlgorithms, PrimeSearch)
+{
+    using namespace algorithms;
+
+    // Against a sieve below 2^16.
+    std::vector<unsigned int> primes;
+    std::vector<bool> composite(1 << 16);
+    for (unsigned int p = 2; p < composite.size(); p++)
+        if (!composite[p]) {
+            primes.push_back(p);
+            for (unsigned int m = 2 * p; m < composite.size(); m += p)
+                composite[m] = true;
+        }
+    for (std::size_t i = 0; i + 1 < primes.size(); i++)
+        for (unsigned int n = primes[i]; n < primes[i + 1]; n++) {
+            ASSERT_EQ(nextPrime(n), primes[i + 1]) << n;
+            if (n > primes[i]) {
+                ASSERT_EQ(prevPrime(n), primes[i]) << n;
+            }
+        }
+    EXPECT_EQ(nextPrime(0), 2);
+    EXPECT_EQ(nextPrime(1), 2);
+    EXPECT_EQ(prevPrime(3), 2);
+    EXPECT_THROW(prevPrime(2), MathError);
+
+    // Across 2^32, where the sieve takes over, and near 2^64 and 2^128.
+    BigUnsigned two32 = BigUnsigned(1) << 32, two64 = BigUnsigned(1) << 64, two128 = BigUnsigned(1) << 128;
+    EXPECT_EQ(prevPrime(two32), two32 - 5);
+    EXPECT_EQ(nextPrime(two32 - 5), two32 + 15);
+    EXPECT_EQ(prevPrime(two32 + 15), two32 - 5);
+    EXPECT_EQ(nextPrime(two64), two64 + 13);
+    EXPECT_EQ(prevPrime(two64), two64 - 59);
+    EXPECT_EQ(nextPrime(two128), two128 + 51);
+    EXPECT_EQ(prevPrime(two128), two128 - 159);
+
+    // Against testing every candidate.
+    std::mt19937_64 rng(50);
+    for (int i = 0; i < 20; i++) {
+        BigUnsigned n = randomBigUnsigned(rng, BigUnsigned::Index(1 + i % 4));
+        BigUnsigned next = nextPrime(n), prev = prevPrime(n);
+        ASSERT_TRUE(isBPSWPrime(next)) << n;
+        ASSERT_TRUE(isBPSWPrime(prev)) << n;
+        for (BigUnsigned c = n + 1; c < next; c += 1)
+            ASSERT_FALSE(isBPSWPrime(c)) << c;
+        for (BigUnsigned c = prev + 1; c < n; c += 1)
+            ASSERT_FALSE(isBPSWPrime(c)) << c;
+    }
+
+    for (BigUnsigned::Index bits : { 2, 3, 10, 32, 33, 64, 65, 200, 512 }) {
+        BigUnsigned p = randomPrime(bits, rng);
+        EXPECT_EQ(p.bitLength(), bits);
+        EXPECT_TRUE(isBPSWPrime(p)) << p;
+    }
+    EXPECT_THROW(randomPrime(1, rng), MathError);
+}
+
+#pragma warning(pop)
@@ -5,12 +5,18 @@
 #pragma warning(disable : 26495)
 #pragma warning(disable : 26812)
 
+#include <algorithm>
 #include <array>
+#include <bitset>
+#include <limits>
 #include <numeric>
+#include <random>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
+#include <fbi/Kernels.hh>
 #include <fbi/fbi.hh>
 
 using namespace fbi;
@@ -88,6 +94,17 @@ inline void testOperatorAddition(const std::string& left, const std::string& rig
     EXPECT_EQ(bigInt.toString(), answer);
 }
 
+// Returns a random number of exactly `blocks' blocks.
+inline BigUnsigned randomBigUnsigned(std::mt19937_64& rng, BigUnsigned::Index blocks)
+{
+    std::vector<BigUnsigned::Blk> b(blocks);
+    for (auto& x : b)
+        x = rng();
+    if (blocks > 0 && b.back() == 0)
+        b.back() = 1;
+    return BigUnsigned{ b.data(), blocks };
+}
+
 inline void testOperatorSubtraction(const std::string& left, const std::string& right, const std::string& answer)
 {
     BigUnsigned bigInt{};
@@ -1046,4 +1063,632 @@ TEST(BigUnsignedOperators, Subtraction)
 
 }
 
+TEST(BigUnsignedOperators, Multiplication)
+{
+    using namespace bigunsigned;
+
+    EXPECT_EQ(BigUnsigned{ 0 } * BigUnsigned{ 12345 }, 0);
+    EXPECT_EQ(BigUnsigned{ 12345 } * BigUnsigned{ 1 }, 12345);
+    EXPECT_EQ((BigUnsigned{ "18446744073709551615" } * BigUnsigned{ "18446744073709551615" }).toString(),
+              "340282366920938463426481119284349108225");
+    EXPECT_EQ((BigUnsigned{ "123456789012345678901234567890" } * BigUnsigned{ "987654321098765432109876543210" })
+                  .toString(),
+              "121932631137021795226185032733622923332237463801111263526900");
+
+    // Sizes around and well above the Karatsuba threshold, balanced and not.
+    std::mt19937_64 rng(27);
+    const BigUnsigned::Index sizes[] = { 1, 5, 31, 32, 33, 64, 97, 150, 301 };
+    for (auto an : sizes) {
+        for (auto bn : sizes) {
+            BigUnsigned a = randomBigUnsigned(rng, an), b = randomBigUnsigned(rng, bn), c = randomBigUnsigned(rng, bn);
+            BigUnsigned ab = a * b;
+            EXPECT_EQ(ab, b * a);
+            EXPECT_EQ(a * (b + c), ab + a * c);
+            if (!a.isZero()) {
+                EXPECT_EQ(ab / a, b);
+                EXPECT_EQ(ab % a, 0);
+            }
+        }
+    }
+}
+
+TEST(BigUnsignedOperators, Division)
+{
+    using namespace bigunsigned;
+
+    EXPECT_EQ(BigUnsigned{ 100 } / BigUnsigned{ 7 }, 14);
+    EXPECT_EQ(BigUnsigned{ 100 } % BigUnsigned{ 7 }, 2);
+    EXPECT_EQ(BigUnsigned{ 5 } / BigUnsigned{ "123456789012345678901234567890" }, 0);
+    EXPECT_EQ(BigUnsigned{ 5 } % BigUnsigned{ "123456789012345678901234567890" }, 5);
+    EXPECT_EQ((BigUnsigned{ "121932631137021795226185032733622923332237463801111263526901" } /
+               BigUnsigned{ "987654321098765432109876543210" })
+                  .toString(),
+              "123456789012345678901234567890");
+    EXPECT_THROW(BigUnsigned{ 5 } / BigUnsigned{}, DivideByZeroError);
+    EXPECT_THROW(BigUnsigned{ 5 } % BigUnsigned{}, DivideByZeroError);
+    BigUnsigned r;
+    EXPECT_THROW(r.mod(5, 0), DivideByZeroError);
+    EXPECT_THROW(r.quotient(5, 0), DivideByZeroError);
+
+    std::mt19937_64 rng(35);
+    const BigUnsigned::Blk top = BigUnsigned::Blk(1) << (BigUnsigned::N - 1);
+    const BigUnsigned::Index sizes[] = { 1, 2, 3, 8, 33 };
+    for (auto an : sizes) {
+        for (auto bn : sizes) {
+            for (int pattern = 0; pattern < 4; ++pattern) {
+                BigUnsigned a = randomBigUnsigned(rng, an + bn), b = randomBigUnsigned(rng, bn);
+                // Divisors and dividends with extreme leading blocks exercise the quotient corrections.
+                if (pattern == 1)
+                    b.setBlock(bn - 1, top);
+                if (pattern == 2) {
+                    b.setBlock(bn - 1, ~BigUnsigned::Blk(0));
+                    a.setBlock(an + bn - 1, ~BigUnsigned::Blk(0));
+                }
+                if (pattern == 3)
+                    a = b * randomBigUnsigned(rng, an) + (b - 1);
+                if (b.isZero())
+                    continue;
+
+                BigUnsigned q, rem = a;
+                rem.divideWithRemainder(b, q);
+                EXPECT_LT(rem, b);
+                EXPECT_EQ(q * b + rem, a);
+                EXPECT_EQ(a / b, q);
+                EXPECT_EQ(a % b, rem);
+                r.quotient(a, b);
+                EXPECT_EQ(r, q);
+                r.mod(a, b);
+                EXPECT_EQ(r, rem);
+                // Aliased calls.
+                r = a;
+                r %= b;
+                EXPECT_EQ(r, rem);
+                r = a;
+                r /= b;
+                EXPECT_EQ(r, q);
+                r = b;
+                r.mod(a, r);
+                EXPECT_EQ(r, rem);
+            }
+        }
+    }
+}
+
+TEST(BigUnsignedOperators, ExactDivision)
+{
+    using namespace bigunsigned;
+
+    BigUnsigned q;
+    q.divideExact(BigUnsigned{ "121932631137021795226185032733622923332237463801111263526900" },
+                  BigUnsigned{ "987654321098765432109876543210" });
+    EXPECT_EQ(q.toString(), "123456789012345678901234567890");
+    q.divideExact(0, BigUnsigned{ "987654321098765432109876543210" });
+    EXPECT_EQ(q, 0);
+    q.divideExact(1000, 8);
+    EXPECT_EQ(q, 125);
+    EXPECT_THROW(q.divideExact(1000, 0), DivideByZeroError);
+    EXPECT_THROW(q.divideExact(1000, BigUnsigned{}), DivideByZeroError);
+
+    std::mt19937_64 rng(34);
+    const BigUnsigned::Index sizes[] = { 1, 2, 3, 17, 40 };
+    for (auto qn : sizes) {
+        for (auto bn : sizes) {
+            BigUnsigned b = randomBigUnsigned(rng, bn), expected = randomBigUnsigned(rng, qn);
+            if (qn == 2)
+                b <<= 70;
+            BigUnsigned a = expected * b;
+            q.divideExact(a, b);
+            EXPECT_EQ(q, expected);
+            q.divideExact(a, expected);
+            EXPECT_EQ(q, b);
+            BigUnsigned::Blk small = BigUnsigned::Blk(rng()) << (bn % 7);
+            q.divideExact(expected * small, small);
+            EXPECT_EQ(q, expected);
+            // Aliased calls.
+            q = a;
+            q.divideExact(q, b);
+            EXPECT_EQ(q, expected);
+        }
+    }
+
+#ifndef NDEBUG
+    // Inexact divisions are caught in checked builds.
+    EXPECT_THROW(q.divideExact(1001, 7 * 11 * 3), MathError);
+    EXPECT_THROW(q.divideExact(1000, 16), MathError);
+    EXPECT_THROW(q.divideExact(BigUnsigned{ "987654321098765432109876543211" }, BigUnsigned{ "123456789012345678901" }),
+                 MathError);
+    EXPECT_THROW(q.divideExact(BigUnsigned{ "987654321098765432109876543210" } << 3,
+                               BigUnsigned{ "987654321098765432109876543210" } << 4),
+                 MathError);
+    EXPECT_THROW(q.divideExact(5, BigUnsigned{ "987654321098765432109876543210" }), MathError);
+#endif
+
+    BigInteger r;
+    r.divideExact(BigInteger(-1000), BigInteger(8));
+    EXPECT_EQ(r, -125);
+    r.divideExact(BigInteger(-1000), BigInteger(-8));
+    EXPECT_EQ(r, 125);
+    r.divideExact(BigInteger(0), BigInteger(-8));
+    EXPECT_EQ(r.getSign(), BigInteger::zero);
+}
+
+TEST(BigUnsignedOperators, FusedMultiplyAdd)
+{
+    using namespace bigunsigned;
+
+    BigUnsigned r = 10;
+    r.addMul(3, 4);
+    EXPECT_EQ(r, 22);
+    r.subMul(4, 5);
+    EXPECT_EQ(r, 2);
+    r.addMulSmall(7, 6);
+    EXPECT_EQ(r, 44);
+    r.subMulSmall(4, 11);
+    EXPECT_EQ(r, 0);
+    r.addMul(0, 5);
+    EXPECT_EQ(r, 0);
+    r = 10;
+    EXPECT_THROW(r.subMul(3, 4), SignError);
+    EXPECT_EQ(r, 0);
+    r = 10;
+    EXPECT_THROW(r.subMulSmall(BigUnsigned{ "987654321098765432109876543210" }, 1), SignError);
+    EXPECT_EQ(r, 0);
+
+    std::mt19937_64 rng(36);
+    const BigUnsigned::Index sizes[] = { 0, 1, 2, 5, 33, 70 };
+    for (auto rn : sizes) {
+        for (auto an : sizes) {
+            for (auto bn : sizes) {
+                BigUnsigned acc = randomBigUnsigned(rng, rn), a = randomBigUnsigned(rng, an), b = randomBigUnsigned(rng, bn);
+                BigUnsigned::Blk small = rng();
+                r = acc;
+                r.addMul(a, b);
+                EXPECT_EQ(r, acc + a * b);
+                r.subMul(a, b);
+                EXPECT_EQ(r, acc);
+                r.addMulSmall(a, small);
+                EXPECT_EQ(r, acc + a * small);
+                r.subMulSmall(a, small);
+                EXPECT_EQ(r, acc);
+                r = acc * b + a;
+                r.subMul(b, acc);
+                EXPECT_EQ(r, a);
+                if (acc < a * b) {
+                    r = acc;
+                    EXPECT_THROW(r.subMul(a, b), SignError);
+                }
+            }
+        }
+        // Aliased calls.
+        BigUnsigned a = randomBigUnsigned(rng, rn), b = randomBigUnsigned(rng, 3);
+        r = a;
+        r.addMul(r, b);
+        EXPECT_EQ(r, a + a * b);
+        r = a;
+        r.addMulSmall(r, 5);
+        EXPECT_EQ(r, a * 6);
+        r = a;
+        r.subMul(r, 1);
+        EXPECT_EQ(r, 0);
+        if (!a.isZero()) {
+            r = a;
+            EXPECT_THROW(r.subMul(b, r), SignError);
+        }
+    }
+
+    // BigIntegers with every combination of signs.
+    const int values[] = { -7, 0, 5 };
+    for (int x : values) {
+        for (int y : values) {
+            for (int z : values) {
+                BigInteger s = x;
+                s.addMul(y, z);
+                EXPECT_EQ(s, x + y * z);
+                s = x;
+                s.subMul(y, z);
+                EXPECT_EQ(s, x - y * z);
+                s = x;
+                s.addMulSmall(y, BigInteger::Blk(z < 0 ? -z : z));
+                EXPECT_EQ(s, x + y * (z < 0 ? -z : z));
+                s = x;
+                s.subMulSmall(y, BigInteger::Blk(z < 0 ? -z : z));
+                EXPECT_EQ(s, x - y * (z < 0 ? -z : z));
+            }
+        }
+    }
+    BigInteger big{ randomBigUnsigned(rng, 40), BigInteger::negative }, s = big;
+    s.addMul(big, BigInteger(-1));
+    EXPECT_EQ(s.getSign(), BigInteger::zero);
+    s = big;
+    s.addMul(s, s);
+    EXPECT_EQ(s, big + big * big);
+}
+
+TEST(BigUnsignedOperators, AliasedCalls)
+{
+    using namespace bigunsigned;
+
+    std::mt19937_64 rng(37);
+    const BigUnsigned::Index sizes[] = { 0, 1, 3, 8 };
+    const int shifts[] = { 0, 1, 63, 64, 65, 200, -5, -64 };
+    for (auto xn : sizes) {
+        for (auto yn : sizes) {
+            BigUnsigned x = randomBigUnsigned(rng, xn), y = randomBigUnsigned(rng, yn), r;
+            r = x;
+            r.add(r, y);
+            EXPECT_EQ(r, x + y);
+            r = y;
+            r.add(x, r);
+            EXPECT_EQ(r, x + y);
+            r = x + y;
+            r.subtract(r, y);
+            EXPECT_EQ(r, x);
+            r = y;
+            r.subtract(x + y, r);
+            EXPECT_EQ(r, x);
+            r = x;
+            r.bitAnd(r, y);
+            EXPECT_EQ(r, x & y);
+            r = x;
+            r.bitOr(y, r);
+            EXPECT_EQ(r, x | y);
+            r = x;
+            r.bitXor(r, y);
+            EXPECT_EQ(r, x ^ y);
+            if (x < y) {
+                r = y;
+                EXPECT_THROW(r.subtract(x, r), SignError);
+            }
+        }
+        BigUnsigned x = randomBigUnsigned(rng, xn), r;
+        r = x;
+        r.add(r, r);
+        EXPECT_EQ(r, x * 2);
+        r.subtract(r, r);
+        EXPECT_EQ(r, 0);
+        r = x;
+        r.bitXor(r, r);
+        EXPECT_EQ(r, 0);
+        r = x;
+        r.bitAnd(r, r);
+        EXPECT_EQ(r, x);
+        for (int k : shifts) {
+            BigUnsigned expected;
+            expected.bitShiftLeft(x, k);
+            r = x;
+            r.bitShiftLeft(r, k);
+            EXPECT_EQ(r, expected);
+            expected.bitShiftRight(x, k);
+            r = x;
+            r.bitShiftRight(r, k);
+            EXPECT_EQ(r, expected);
+        }
+    }
+
+    BigInteger a(-12), b(5);
+    a.add(a, b);
+    EXPECT_EQ(a, -7);
+    b.subtract(a, b);
+    EXPECT_EQ(b, -12);
+    a.subtract(a, a);
+    EXPECT_EQ(a.getSign(), BigInteger::zero);
+    b.negate(b);
+    EXPECT_EQ(b, 12);
+}
+
+TEST(BigUnsignedOperators, PrimitiveOperands)
+{
+    using namespace bigunsigned;
+
+    std::mt19937_64 rng(38);
+    const unsigned long long blockMax = ~0ULL;
+    const BigUnsigned::Index sizes[] = { 0, 1, 2, 5 };
+    for (auto n : sizes) {
+        BigUnsigned x = randomBigUnsigned(rng, n);
+        const unsigned long long smalls[] = { 1, 10, rng(), blockMax };
+        for (auto m : smalls) {
+            BigUnsigned big = m;
+            EXPECT_EQ(x + m, x + big);
+            EXPECT_EQ(x * m, x * big);
+            EXPECT_EQ(x / m, x / big);
+            EXPECT_EQ(x % m, x % big);
+            EXPECT_EQ(x & m, x & big);
+            EXPECT_EQ(x | m, x | big);
+            EXPECT_EQ(x ^ m, x ^ big);
+            EXPECT_EQ(x == m, x == big);
+            EXPECT_EQ(x < m, x < big);
+            EXPECT_EQ(x >= m, x >= big);
+            if (x >= big) {
+                EXPECT_EQ(x - m, x - big);
+            }
+            else
+                EXPECT_THROW(x - m, SignError);
+            BigUnsigned r = x;
+            r += m;
+            EXPECT_EQ(r, x + big);
+            r -= m;
+            EXPECT_EQ(r, x);
+            r *= m;
+            EXPECT_EQ(r, x * big);
+            r /= m;
+            EXPECT_EQ(r, x);
+            r %= m;
+            EXPECT_EQ(r, x % big);
+            r = x;
+            r &= m;
+            EXPECT_EQ(r, x & big);
+            r = x;
+            r ^= m;
+            EXPECT_EQ(r, x ^ big);
+            r |= m;
+            EXPECT_EQ(r, x | big);
+        }
+    }
+    BigUnsigned x = blockMax;
+    x += 1;
+    EXPECT_EQ(x.toString(), "18446744073709551616");
+    x -= 1;
+    EXPECT_EQ(x, blockMax);
+    EXPECT_TRUE(BigUnsigned{} == 0);
+    EXPECT_THROW(x / 0, DivideByZeroError);
+    EXPECT_THROW(x % 0, DivideByZeroError);
+    EXPECT_THROW(x + -1, SignError);
+
+    // BigIntegers, with the rounding of divideWithRemainder.
+    const int values[] = { -7, -6, -1, 0, 1, 6, 7 };
+    const int divisors[] = { -3, -1, 1, 3 };
+    for (int a : values) {
+        BigInteger y = a;
+        for (int b : divisors) {
+            BigInteger q, r = y;
+            r.divideWithRemainder(BigInteger(b), q);
+            EXPECT_EQ(y / b, q);
+            EXPECT_EQ(y % b, r);
+            EXPECT_EQ(y + b, a + b);
+            EXPECT_EQ(y - b, a - b);
+            EXPECT_EQ(y * b, a * b);
+            EXPECT_EQ(y < b, a < b);
+            EXPECT_EQ(y == b, a == b);
+            BigInteger z = y;
+            z -= b;
+            EXPECT_EQ(z, a - b);
+            z += b;
+            z *= b;
+            EXPECT_EQ(z, a * b);
+            z = y;
+            z /= b;
+            EXPECT_EQ(z, q);
+            z = y;
+            z %= b;
+            EXPECT_EQ(z, r);
+        }
+    }
+    BigInteger y = -1;
+    y *= std::numeric_limits<long long>::min();
+    EXPECT_EQ(y.toString(), "9223372036854775808");
+    y += std::numeric_limits<long long>::min();
+    EXPECT_EQ(y.getSign(), BigInteger::zero);
+    EXPECT_THROW(y / 0, DivideByZeroError);
+}
+
+TEST(BigUnsignedOperators, CarryChains)
+{
+    // Carries and borrows that run through every block, for lengths on both
+    // sides of the four-block groups of the addition kernels.
+    for (BigUnsigned::Index n = 1; n <= 13; n++) {
+        std::vector<BigUnsigned::Blk> ones(n, ~BigUnsigned::Blk(0));
+        BigUnsigned x(ones.data(), n), power = BigUnsigned(1) << int(n * BigUnsigned::N);
+        EXPECT_EQ(x + 1, power);
+        EXPECT_EQ(x + x, power + x - 1);
+        EXPECT_EQ(power - 1, x);
+        EXPECT_EQ(power - x, 1);
+        BigUnsigned r = x;
+        r.add(r, x);
+        r.subtract(r, x);
+        EXPECT_EQ(r, x);
+        r = power;
+        r.subtract(r, x);
+        EXPECT_EQ(r, 1);
+        EXPECT_THROW(r.subtract(x, power), SignError);
+    }
+}
+
+TEST(BigUnsignedOperators, MultiplyKernels)
+{
+    const std::string name = multiplyKernelName();
+    const CpuFeatures& cpu = cpuFeatures();
+    if (cpu.bmi2 && cpu.adx && cpu.avx512ifma)
+        EXPECT_EQ(name, "avx512-ifma");
+    else if (cpu.bmi2 && cpu.adx)
+        EXPECT_EQ(name, "bmi2-adx");
+    else
+        EXPECT_EQ(name, "generic");
+
+    // Products, squares and Montgomery products on every supported family,
+    // including the portable model of the radix-52 kernels, against the
+    // generic one.  The lengths are around the four-block groups of the row
+    // kernels, the limits of the radix-52 ones and the Karatsuba thresholds.
+    std::mt19937_64 rng(40);
+    std::vector<BigUnsigned> x, y;
+    const BigUnsigned::Index lengths[] = { 1,  2,  3,  4,  5,  7,  8,   9,   11,  12,  13,
+                                           17, 23, 24, 31, 32, 33, 67, 127, 128, 207, 208 };
+    for (BigUnsigned::Index n : lengths) {
+        std::vector<BigUnsigned::Blk> a(n), b(n);
+        for (BigUnsigned::Index i = 0; i < n; i++) {
+            a[i] = rng();
+            b[i] = ~BigUnsigned::Blk(0) - (i % 3);
+        }
+        x.emplace_back(a.data(), n);
+        y.emplace_back(b.data(), n);
+    }
+    auto results = [&]() {
+        std::vector<BigUnsigned> r;
+        for (std::size_t i = 0; i < x.size(); i++) {
+            BigUnsigned square = x[i];
+            square.multiply(square, square);
+            BigUnsigned copy = x[i];
+            EXPECT_EQ(square, x[i] * copy);
+            r.push_back(square);
+            r.push_back(x[i] * y[i]);
+            MontgomeryContext context(y[i] | 1);
+            BigUnsigned xm = context.toMontgomery(x[i]);
+            r.push_back(context.multiply(xm, xm));
+            r.push_back(context.multiply(xm, context.toMontgomery(y[i])));
+            r.push_back(context.exp(x[i], BigUnsigned(y[i].getBlock(0))));
+        }
+        return r;
+    };
+    const detail::MultiplyKernels& active = detail::multiplyKernels();
+    const auto& available = detail::availableMultiplyKernels();
+    ASSERT_GE(available.size(), 2u);
+    EXPECT_EQ(available[0], &detail::genericKernels);
+    EXPECT_EQ(available[1], &detail::radix52Kernels);
+    detail::selectMultiplyKernels(*available.front());
+    std::vector<BigUnsigned> expected = results();
+    for (const detail::MultiplyKernels* k : available) {
+        detail::selectMultiplyKernels(*k);
+        EXPECT_EQ(results(), expected) << k->name;
+    }
+    detail::selectMultiplyKernels(active);
+    EXPECT_EQ(multiplyKernelName(), name);
+}
+
+TEST(BigUnsignedOperators, BitwiseKernels)
+{
+    // Bitwise operators, comparisons, shifts and bit counts on every
+    // supported family, at lengths around each family's vector width.
+    std::mt19937_64 rng(42);
+    const BigUnsigned::Index lengths[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 23, 31, 32, 33, 100 };
+    const detail::BitwiseKernels& active = detail::bitwiseKernels();
+    const auto& available = detail::availableBitwiseKernels();
+    ASSERT_GE(available.size(), 1u);
+    EXPECT_EQ(available[0], &detail::genericBitwiseKernels);
+    EXPECT_EQ(available.back(), &active);
+    for (const detail::BitwiseKernels* k : available) {
+        detail::selectBitwiseKernels(*k);
+        for (BigUnsigned::Index an : lengths)
+            for (BigUnsigned::Index bn : { an, an / 2, an + 5 }) {
+                std::vector<BigUnsigned::Blk> a(an), b(bn), andBlocks, orBlocks, xorBlocks;
+                for (auto& v : a)
+                    v = rng();
+                for (auto& v : b)
+                    v = rng();
+                for (BigUnsigned::Index i = 0; i < std::max(an, bn); i++) {
+                    BigUnsigned::Blk u = (i < an) ? a[i] : 0, v = (i < bn) ? b[i] : 0;
+                    andBlocks.push_back(u & v);
+                    orBlocks.push_back(u | v);
+                    xorBlocks.push_back(u ^ v);
+                }
+                BigUnsigned x(a.data(), an), y(b.data(), bn);
+                EXPECT_EQ(x & y, BigUnsigned(andBlocks.data(), BigUnsigned::Index(andBlocks.size()))) << k->name;
+                EXPECT_EQ(x | y, BigUnsigned(orBlocks.data(), BigUnsigned::Index(orBlocks.size()))) << k->name;
+                EXPECT_EQ(x ^ y, BigUnsigned(xorBlocks.data(), BigUnsigned::Index(xorBlocks.size()))) << k->name;
+                BigUnsigned z = x;
+                z ^= y;
+                z ^= y;
+                EXPECT_EQ(z, x) << k->name;
+                BigUnsigned::Index ones = 0, differences = 0;
+                for (BigUnsigned::Index j = 0; j < an; j++)
+                    ones += BigUnsigned::Index(std::bitset<64>(a[j]).count());
+                for (BigUnsigned::Blk v : xorBlocks)
+                    differences += BigUnsigned::Index(std::bitset<64>(v).count());
+                EXPECT_EQ(x.popCount(), ones) << k->name;
+                EXPECT_EQ(x.hammingDistance(y), differences) << k->name;
+                EXPECT_EQ(y.hammingDistance(x), differences) << k->name;
+            }
+
+        // Numbers of the same length that differ in exactly one block.
+        for (BigUnsigned::Index n : lengths) {
+            std::vector<BigUnsigned::Blk> a(n);
+            for (auto& v : a)
+                v = rng() | 1;
+            BigUnsigned x(a.data(), n);
+            EXPECT_EQ(x.compareTo(BigUnsigned(a.data(), n)), BigUnsigned::equal) << k->name;
+            for (BigUnsigned::Index i = 0; i < n; i++) {
+                std::vector<BigUnsigned::Blk> b = a;
+                b[i] ^= 1;
+                BigUnsigned y(b.data(), n);
+                EXPECT_EQ(x.compareTo(y), BigUnsigned::greater) << k->name << " " << n << " " << i;
+                EXPECT_EQ(y.compareTo(x), BigUnsigned::less) << k->name << " " << n << " " << i;
+                EXPECT_NE(x, y) << k->name;
+                if (i > 0) {
+                    // A difference further down must not change the outcome.
+                    b[0] ^= 2;
+                    EXPECT_EQ(x.compareTo(BigUnsigned(b.data(), n)), BigUnsigned::greater) << k->name;
+                }
+            }
+        }
+
+        // Shifts against multiplication and division by powers of two, in
+        // place and not, by whole blocks and by odd bit counts.
+        for (BigUnsigned::Index n : lengths) {
+            if (n == 0)
+                continue;
+            std::vector<BigUnsigned::Blk> a(n);
+            for (auto& v : a)
+                v = rng();
+            BigUnsigned x(a.data(), n);
+            for (int shift : { 1, 5, 63, 64, 65, 128, 200, 64 * 17 + 3 }) {
+                BigUnsigned power = BigUnsigned(1) << shift, r;
+                EXPECT_EQ(power.bitLength(), BigUnsigned::Index(shift + 1)) << k->name;
+                r.bitShiftLeft(x, shift);
+                EXPECT_EQ(r, x * power) << k->name << " " << n << " " << shift;
+                r = x;
+                r <<= shift;
+                EXPECT_EQ(r, x * power) << k->name << " " << n << " " << shift;
+                r.bitShiftRight(x, shift);
+                EXPECT_EQ(r, x / power) << k->name << " " << n << " " << shift;
+                r = x;
+                r >>= shift;
+                EXPECT_EQ(r, x / power) << k->name << " " << n << " " << shift;
+            }
+        }
+    }
+    detail::selectBitwiseKernels(active);
+}
+
+TEST(BigUnsignedBits, CountsAndScans)
+{
+    EXPECT_EQ(BigUnsigned(0).bitLength(), 0u);
+    EXPECT_EQ(BigUnsigned(0).popCount(), 0u);
+    EXPECT_EQ(BigUnsigned(0).trailingZeros(), 0u);
+    EXPECT_EQ(BigUnsigned(0).nextSetBit(0), BigUnsigned::npos);
+    EXPECT_EQ(BigUnsigned(0).nextClearBit(5), 5u);
+    EXPECT_EQ(BigUnsigned(1).bitLength(), 1u);
+    EXPECT_EQ(BigUnsigned(0x80u).trailingZeros(), 7u);
+    EXPECT_EQ(BigUnsigned(~0ull).nextClearBit(0), 64u);
+    EXPECT_EQ(BigUnsigned(12).hammingDistance(BigUnsigned(10)), 2u);
+
+    // Sparse and dense numbers spanning several blocks, against getBit.
+    std::mt19937_64 rng(44);
+    for (int round = 0; round < 20; round++) {
+        BigUnsigned x;
+        for (int i = 0; i < 12; i++)
+            x.setBit(BigUnsigned::Index(rng() % 700), true);
+        if (round % 2 == 1)
+            x ^= (BigUnsigned(1) << 640) - 1;
+        BigUnsigned::Index length = 0, ones = 0;
+        for (BigUnsigned::Index i = 0; i < 800; i++)
+            if (x.getBit(i)) {
+                length = i + 1;
+                ones++;
+            }
+        EXPECT_EQ(x.bitLength(), length);
+        EXPECT_EQ(x.popCount(), ones);
+        for (BigUnsigned::Index from = 0; from < 800; from += 7) {
+            BigUnsigned::Index set = from, clear = from;
+            while (set < 800 && !x.getBit(set))
+                set++;
+            while (x.getBit(clear))
+                clear++;
+            EXPECT_EQ(x.nextSetBit(from), set < 800 ? set : BigUnsigned::npos) << from;
+            EXPECT_EQ(x.nextClearBit(from), clear) << from;
+        }
+        EXPECT_EQ(x.trailingZeros(), x.nextSetBit(0));
+        EXPECT_EQ(x.hammingDistance(x), 0u);
+        EXPECT_EQ(x.hammingDistance(0), ones);
+        EXPECT_EQ(x.hammingDistance(x << 1), (x ^ (x << 1)).popCount());
+    }
+}
+
 #pragma warning(pop)
\ No newline at end of file
@@ -5,6 +5,7 @@
 
 #include <gtest/gtest.h>
 
+#include "BigIntegerAlgorithmsTests.hh"
 #include "BigUnsignedTests.hh"
 
 int main(int argc, char *argv[])